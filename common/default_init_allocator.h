@@ -0,0 +1,43 @@
+#ifndef FONTUS_DEFAULT_INIT_ALLOCATOR_H
+#define FONTUS_DEFAULT_INIT_ALLOCATOR_H
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace fontus {
+
+// Allocator whose value-less construct default-initializes instead of
+// value-initializing. A std::vector<int, DefaultInitAllocator<int>> of
+// size n is then not zeroed, so its pages are first touched, and on a
+// NUMA machine placed, by whichever thread writes them first.
+template <typename T, typename Base = std::allocator<T>>
+class DefaultInitAllocator : public Base {
+  typedef std::allocator_traits<Base> traits;
+
+public:
+  template <typename U>
+  struct rebind {
+    typedef DefaultInitAllocator<U,
+        typename traits::template rebind_alloc<U>> other;
+  };
+
+  using Base::Base;
+
+  template <typename U>
+  void construct(U* ptr) noexcept(
+      std::is_nothrow_default_constructible<U>::value) {
+    ::new (static_cast<void*>(ptr)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* ptr, Args&&... args) {
+    traits::construct(static_cast<Base&>(*this), ptr,
+        std::forward<Args>(args)...);
+  }
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_DEFAULT_INIT_ALLOCATOR_H */
@@ -0,0 +1,198 @@
+#ifndef FONTUS_FLAT_HASH_MAP_H
+#define FONTUS_FLAT_HASH_MAP_H
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fontus {
+
+// Finalizer from MurmurHash3. std::hash is the identity for integers,
+// which clusters badly in a power-of-two table with linear probing.
+inline size_t mix_hash(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+template <typename T>
+struct FlatHash {
+  size_t operator()(const T& key) const {
+    return mix_hash(std::hash<T>()(key));
+  }
+};
+
+// Strings hash through string_view so that a std::string keyed map
+// can be probed with a string_view or a string literal.
+template <>
+struct FlatHash<std::string> {
+  typedef void is_transparent;
+
+  size_t operator()(std::string_view key) const {
+    return mix_hash(std::hash<std::string_view>()(key));
+  }
+};
+
+// Open-addressing hash map with linear probing and backward-shift
+// deletion: entries live in one array, so lookups and inserts do not
+// allocate, and erase leaves no tombstones behind. Lookups take any
+// type the hasher and KeyEqual accept (heterogeneous lookup).
+template <typename K, typename V, typename Hash = FlatHash<K>,
+          typename KeyEqual = std::equal_to<>>
+class FlatHashMap {
+public:
+  typedef std::pair<K, V> value_type;
+
+  FlatHashMap() : size_(0) {}
+
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  // Makes room for count entries without rehashing.
+  void reserve(size_t count) {
+    size_t capacity = 8;
+    while (capacity * 3 < count * 4) {
+      capacity *= 2;
+    }
+    if (capacity > slots_.size()) {
+      rehash(capacity);
+    }
+  }
+
+  template <typename Q>
+  V* find(const Q& key) {
+    return const_cast<V*>(static_cast<const FlatHashMap*>(this)->find(key));
+  }
+
+  template <typename Q>
+  const V* find(const Q& key) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    for (size_t i = home(key); slots_[i]; i = next(i)) {
+      if (KeyEqual()(slots_[i]->first, key)) {
+        return &slots_[i]->second;
+      }
+    }
+    return nullptr;
+  }
+
+  template <typename Q>
+  bool contains(const Q& key) const {
+    return find(key) != nullptr;
+  }
+
+  // Inserts unless the key is present. Returns the mapped value and
+  // whether it was inserted.
+  std::pair<V*, bool> emplace(K key, V value) {
+    if (V* found = find(key)) {
+      return {found, false};
+    }
+    // Grow only for a real insert, so that emplacing present keys never
+    // rehashes and never moves the values pointers refer to.
+    if ((size_ + 1) * 4 > slots_.size() * 3) {
+      rehash(slots_.empty() ? 8 : 2 * slots_.size());
+    }
+
+    size_t i = home(key);
+    while (slots_[i]) {
+      i = next(i);
+    }
+    slots_[i].emplace(std::move(key), std::move(value));
+    ++size_;
+    return {&slots_[i]->second, true};
+  }
+
+  template <typename Q>
+  bool erase(const Q& key) {
+    if (slots_.empty()) {
+      return false;
+    }
+
+    size_t hole = home(key);
+    for (; slots_[hole]; hole = next(hole)) {
+      if (KeyEqual()(slots_[hole]->first, key)) {
+        break;
+      }
+    }
+    if (!slots_[hole]) {
+      return false;
+    }
+
+    // Pull later entries of the probe run back into the hole unless
+    // that would move them before their home slot.
+    for (size_t i = next(hole); slots_[i]; i = next(i)) {
+      size_t ideal = home(slots_[i]->first);
+      if (((i - ideal) & mask()) >= ((i - hole) & mask())) {
+        slots_[hole] = std::move(slots_[i]);
+        hole = i;
+      }
+    }
+    slots_[hole].reset();
+    --size_;
+    return true;
+  }
+
+  void clear() {
+    for (auto& slot: slots_) {
+      slot.reset();
+    }
+    size_ = 0;
+  }
+
+  template <typename F>
+  void for_each(F action) const {
+    for (auto& slot: slots_) {
+      if (slot) {
+        action(slot->first, slot->second);
+      }
+    }
+  }
+
+private:
+  std::vector<std::optional<value_type>> slots_;
+  size_t size_;
+
+  size_t mask() const {
+    return slots_.size() - 1;
+  }
+
+  template <typename Q>
+  size_t home(const Q& key) const {
+    return Hash()(key) & mask();
+  }
+
+  size_t next(size_t i) const {
+    return (i + 1) & mask();
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<std::optional<value_type>> old(capacity);
+    old.swap(slots_);
+    for (auto& slot: old) {
+      if (slot) {
+        size_t i = home(slot->first);
+        while (slots_[i]) {
+          i = next(i);
+        }
+        slots_[i] = std::move(slot);
+      }
+    }
+  }
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_FLAT_HASH_MAP_H */
@@ -12,8 +12,10 @@ typedef std::vector<std::set<vertex_type>> adjacency_list;
 
 class DirectedAcyclicGraph {
 public:
+  static constexpr size_t MAX_DIST = (2<<28);
+
   DirectedAcyclicGraph(unsigned int vertex_count, bool weighted) :
-    weighted_(weighted) {
+    weighted_(weighted), tracking_(false) {
 
     // Reserve and initialize storage for adjacency list.
     adj_list_.reserve(vertex_count);
@@ -28,12 +30,41 @@ public:
                                  double weight = 1.0) {
     assert(fontus::equals(weight, 1.0) || weighted_);
     assert(start < adj_list_.size() && end < adj_list_.size());
+    bool inserted = !adj_list_[start].count(end);
+    if (tracking_ && inserted && rank_[end] < rank_[start]) {
+      // the cached order must be repaired before the edge goes in
+      reorder(start, end);
+    }
     // create or update edge
     adj_list_[start].insert(end);
     edge_weights_[std::make_pair(start, end)] = weight;
+    if (tracking_) {
+      if (inserted) {
+        rev_adj_list_[end].insert(start);
+      }
+      propagate(end);
+    }
     return *this;
   }
 
+  size_t vertex_count() const {
+    return adj_list_.size();
+  }
+
+  const std::set<vertex_type>& adjacent(vertex_type u) const {
+    return adj_list_[u];
+  }
+
+  // Calls action(start, end, weight) once for every edge.
+  template <typename T>
+  void for_each_edge(T action) const {
+    for (vertex_type u = 0; u < adj_list_.size(); ++u) {
+      for (vertex_type v: adj_list_[u]) {
+        action(u, v, edge_weights_.at(std::make_pair(u, v)));
+      }
+    }
+  }
+
   template <typename T, typename... U>
   void dfs(vertex_type vertex, std::set<vertex_type>& visited,
            T action, U&... args) const {
@@ -65,7 +96,6 @@ public:
 
   std::vector<size_t> ss_shortest_path(vertex_type source) {
     assert(source < adj_list_.size());
-    auto MAX_DIST = (2<<28);
     std::vector<size_t> dist_vec(adj_list_.size(), MAX_DIST);
     dist_vec[source] = 0;
 
@@ -97,10 +127,160 @@ public:
     return dist_vec;
   }
 
+  // Starts maintaining shortest distances from source across later
+  // add_edge calls. The topological order and the distances are
+  // cached; a new or re-weighted edge only revisits the descendants
+  // of its end vertex whose distance actually changes, in
+  // topological order. Inserting an edge that goes against the
+  // cached order repairs the order locally (Pearce-Kelly).
+  const std::vector<size_t>& track_shortest_paths(vertex_type source) {
+    assert(source < adj_list_.size());
+    tracked_source_ = source;
+    order_ = topsort();
+    rank_.assign(adj_list_.size(), 0);
+    for (size_t i = 0; i < order_.size(); ++i) {
+      rank_[order_[i]] = i;
+    }
+    rev_adj_list_.assign(adj_list_.size(), std::set<vertex_type>());
+    for (vertex_type u = 0; u < adj_list_.size(); ++u) {
+      for (vertex_type v: adj_list_[u]) {
+        rev_adj_list_[v].insert(u);
+      }
+    }
+    marked_.assign(adj_list_.size(), false);
+    dist_ = ss_shortest_path(source);
+    tracking_ = true;
+    return dist_;
+  }
+
+  // Distances from the tracked source, kept current by add_edge.
+  const std::vector<size_t>& shortest_paths() const {
+    assert(tracking_);
+    return dist_;
+  }
+
+  void stop_tracking() {
+    tracking_ = false;
+    order_.clear();
+    rank_.clear();
+    dist_.clear();
+    rev_adj_list_.clear();
+    marked_.clear();
+  }
+
 private:
   adjacency_list adj_list_;
   bool weighted_;
   std::map<edge_type, double> edge_weights_;
+
+  // Incremental shortest path state, valid while tracking_ is set.
+  bool tracking_;
+  vertex_type tracked_source_;
+  std::vector<vertex_type> order_;
+  std::vector<size_t> rank_;
+  std::vector<size_t> dist_;
+  adjacency_list rev_adj_list_;
+  // Scratch flags, all false between calls.
+  std::vector<bool> marked_;
+
+  // Recomputes the distance of vertex and of every descendant whose
+  // distance depends on it. Vertices are settled in topological order
+  // so each one sees final distances for all its predecessors.
+  void propagate(vertex_type vertex) {
+    std::priority_queue<size_t, std::vector<size_t>,
+                        std::greater<size_t>> pending;
+    pending.push(rank_[vertex]);
+    marked_[vertex] = true;
+
+    while (!pending.empty()) {
+      vertex_type u = order_[pending.top()];
+      pending.pop();
+      marked_[u] = false;
+
+      size_t best = (u == tracked_source_) ? 0 : MAX_DIST;
+      for (vertex_type p: rev_adj_list_[u]) {
+        if (dist_[p] == MAX_DIST) {
+          continue;
+        }
+        size_t candidate = dist_[p] + edge_weights_[std::make_pair(p, u)];
+        best = std::min(best, candidate);
+      }
+      if (best == dist_[u]) {
+        continue;
+      }
+
+      dist_[u] = best;
+      for (vertex_type v: adj_list_[u]) {
+        if (!marked_[v]) {
+          marked_[v] = true;
+          pending.push(rank_[v]);
+        }
+      }
+    }
+  }
+
+  // Makes room for a new edge start -> end where end currently sorts
+  // before start. Only vertices ranked between the two move: those
+  // reachable from end and those reaching start swap blocks, reusing
+  // the same set of ranks.
+  void reorder(vertex_type start, vertex_type end) {
+    size_t lower = rank_[end], upper = rank_[start];
+
+    auto collect = [&](vertex_type from, const adjacency_list& adj,
+                       std::vector<vertex_type>& visited, bool forward) {
+      std::vector<vertex_type> stack{from};
+      marked_[from] = true;
+      while (!stack.empty()) {
+        vertex_type u = stack.back();
+        stack.pop_back();
+        visited.push_back(u);
+        for (vertex_type v: adj[u]) {
+          bool in_window = forward ? rank_[v] <= upper : rank_[v] >= lower;
+          if (v == start && forward) {
+            for (vertex_type w: visited) {
+              marked_[w] = false;
+            }
+            for (vertex_type w: stack) {
+              marked_[w] = false;
+            }
+            throw std::runtime_error("edge would create a cycle");
+          }
+          if (in_window && !marked_[v]) {
+            marked_[v] = true;
+            stack.push_back(v);
+          }
+        }
+      }
+    };
+
+    std::vector<vertex_type> reachable, reaching;
+    collect(end, adj_list_, reachable, true);
+    collect(start, rev_adj_list_, reaching, false);
+
+    auto by_rank = [&](vertex_type a, vertex_type b) {
+      return rank_[a] < rank_[b];
+    };
+    std::sort(reaching.begin(), reaching.end(), by_rank);
+    std::sort(reachable.begin(), reachable.end(), by_rank);
+
+    std::vector<size_t> ranks;
+    for (vertex_type v: reaching) {
+      ranks.push_back(rank_[v]);
+    }
+    for (vertex_type v: reachable) {
+      ranks.push_back(rank_[v]);
+    }
+    std::sort(ranks.begin(), ranks.end());
+
+    size_t next = 0;
+    for (auto* group: {&reaching, &reachable}) {
+      for (vertex_type v: *group) {
+        rank_[v] = ranks[next++];
+        order_[rank_[v]] = v;
+        marked_[v] = false;
+      }
+    }
+  }
 };
 
 } // namespace fontus
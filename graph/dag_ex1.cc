@@ -28,4 +28,56 @@ int main() {
   for (auto dist: dist_vec) {
     std::cout << "dist[" << v++ << "] = " << dist << '\n';
   }
+
+  // Tracked distances must match a fresh run after every insertion.
+  auto tracked_ok = [](fontus::DirectedAcyclicGraph& graph,
+                       fontus::vertex_type source) {
+    return graph.shortest_paths() == graph.ss_shortest_path(source);
+  };
+
+  g.track_shortest_paths(5);
+  bool ok = true;
+  g.add_edge(0, 3, 1);   // 3 sorts before 0, so the order is repaired
+  ok = ok && tracked_ok(g, 5);
+  g.add_edge(5, 2, 1);   // new shortcut
+  ok = ok && tracked_ok(g, 5);
+  g.add_edge(4, 2, 9);   // heavier, no longer on a shortest path
+  ok = ok && tracked_ok(g, 5);
+  g.add_edge(6, 3, 1);   // lighter
+  ok = ok && tracked_ok(g, 5);
+  v = 0;
+  for (auto dist: g.shortest_paths()) {
+    std::cout << "dist[" << v++ << "] = " << dist << '\n';
+  }
+
+  // Random edges consistent with a hidden order, so most of them go
+  // against the cached one.
+  const unsigned int n = 60;
+  std::mt19937 rng(7);
+  std::vector<fontus::vertex_type> hidden(n);
+  std::iota(hidden.begin(), hidden.end(), 0);
+  std::shuffle(hidden.begin(), hidden.end(), rng);
+  fontus::DirectedAcyclicGraph random_dag(n, true);
+  random_dag.track_shortest_paths(hidden[0]);
+  for (int i = 0; i < 500 && ok; ++i) {
+    unsigned int a = rng() % n, b = rng() % n;
+    if (a == b) {
+      continue;
+    }
+    if (a > b) {
+      std::swap(a, b);
+    }
+    random_dag.add_edge(hidden[a], hidden[b], 1 + rng() % 9);
+    ok = tracked_ok(random_dag, hidden[0]);
+  }
+
+  try {
+    g.add_edge(0, 8, 1);
+    ok = false;
+  } catch (const std::runtime_error&) {
+    ok = ok && tracked_ok(g, 5);
+  }
+
+  std::cout << "Tracked distances " << (ok ? "match" : "differ") << '\n';
+  return ok ? 0 : 1;
 }
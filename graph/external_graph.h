@@ -0,0 +1,297 @@
+#ifndef FONTUS_EXTERNAL_GRAPH_H
+#define FONTUS_EXTERNAL_GRAPH_H
+
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "graph/dag.h"
+
+namespace fontus {
+
+// On-disk edge file: a fixed header followed by (start, end) pairs of
+// vertex_type in no particular order.
+struct EdgeFileHeader {
+  static constexpr uint64_t MAGIC = 0x45474445534e4f46ull;  // "FONSEDGE"
+
+  uint64_t magic;
+  uint64_t vertex_count;
+  uint64_t edge_count;
+};
+
+// Appends edges to an edge file through a large write buffer. The
+// header is rewritten with the final edge count on close().
+class EdgeFileWriter {
+public:
+  EdgeFileWriter(const std::string& path, vertex_type vertex_count,
+                 size_t buffer_bytes = 8 << 20) :
+    vertex_count_(vertex_count), edge_count_(0) {
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error("cannot create edge file " + path);
+    }
+    buffer_.reserve(std::max<size_t>(buffer_bytes / sizeof(edge_type), 1));
+    write_header();
+    ::lseek(fd_, sizeof(EdgeFileHeader), SEEK_SET);
+  }
+
+  EdgeFileWriter(const EdgeFileWriter&) = delete;
+  EdgeFileWriter& operator=(const EdgeFileWriter&) = delete;
+
+  ~EdgeFileWriter() {
+    if (fd_ >= 0) {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+  }
+
+  EdgeFileWriter& add_edge(vertex_type start, vertex_type end) {
+    assert(start < vertex_count_ && end < vertex_count_);
+    buffer_.emplace_back(start, end);
+    ++edge_count_;
+    if (buffer_.size() == buffer_.capacity()) {
+      flush();
+    }
+    return *this;
+  }
+
+  void close() {
+    flush();
+    write_header();
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+private:
+  int fd_;
+  vertex_type vertex_count_;
+  uint64_t edge_count_;
+  std::vector<std::pair<vertex_type, vertex_type>> buffer_;
+
+  void write_header() {
+    EdgeFileHeader header{EdgeFileHeader::MAGIC, vertex_count_, edge_count_};
+    if (::pwrite(fd_, &header, sizeof(header), 0) != sizeof(header)) {
+      throw std::runtime_error("cannot write edge file header");
+    }
+  }
+
+  void flush() {
+    const char* data = reinterpret_cast<const char*>(buffer_.data());
+    size_t remaining = buffer_.size() * sizeof(buffer_[0]);
+    while (remaining > 0) {
+      ssize_t written = ::write(fd_, data, remaining);
+      if (written < 0 && errno != EINTR) {
+        throw std::runtime_error("cannot write edge file");
+      }
+      if (written > 0) {
+        data += written;
+        remaining -= written;
+      }
+    }
+    buffer_.clear();
+  }
+};
+
+inline void write_edge_file(const std::string& path,
+                            const DirectedAcyclicGraph& graph) {
+  EdgeFileWriter writer(path, graph.vertex_count());
+  graph.for_each_edge([&](vertex_type u, vertex_type v, double) {
+    writer.add_edge(u, v);
+  });
+  writer.close();
+}
+
+// Semi-external graph: only O(V) per-vertex state is kept in memory
+// and every algorithm works in sequential passes over the edge file,
+// read through a large buffer with the kernel told to read ahead.
+class SemiExternalGraph {
+public:
+  static constexpr unsigned int UNREACHED =
+    std::numeric_limits<unsigned int>::max();
+
+  explicit SemiExternalGraph(std::string path, size_t buffer_bytes = 8 << 20) :
+    path_(std::move(path)),
+    buffer_edges_(std::max<size_t>(buffer_bytes / sizeof(edge_type), 1)),
+    passes_(0) {
+    int fd = open_file();
+    EdgeFileHeader header;
+    bool ok = ::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+      header.magic == EdgeFileHeader::MAGIC;
+    ::close(fd);
+    if (!ok) {
+      throw std::runtime_error("not an edge file: " + path_);
+    }
+    vertex_count_ = header.vertex_count;
+    edge_count_ = header.edge_count;
+  }
+
+  size_t vertex_count() const {
+    return vertex_count_;
+  }
+
+  uint64_t edge_count() const {
+    return edge_count_;
+  }
+
+  // Number of passes over the edge file made so far.
+  size_t passes() const {
+    return passes_;
+  }
+
+  // One sequential pass: calls action(start, end) for every edge.
+  template <typename T>
+  void for_each_edge(T action) const {
+    ++passes_;
+    int fd = open_file();
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::vector<std::pair<vertex_type, vertex_type>> buffer(buffer_edges_);
+    char* data = reinterpret_cast<char*>(buffer.data());
+    off_t offset = sizeof(EdgeFileHeader);
+    uint64_t remaining = edge_count_;
+
+    while (remaining > 0) {
+      size_t want = std::min<uint64_t>(remaining, buffer.size()) *
+        sizeof(buffer[0]);
+      size_t have = 0;
+      while (have < want) {
+        ssize_t got = ::pread(fd, data + have, want - have, offset + have);
+        if (got <= 0 && !(got < 0 && errno == EINTR)) {
+          ::close(fd);
+          throw std::runtime_error("short read from edge file " + path_);
+        }
+        if (got > 0) {
+          have += got;
+        }
+      }
+      offset += have;
+
+      size_t count = have / sizeof(buffer[0]);
+      for (size_t i = 0; i < count; ++i) {
+        action(buffer[i].first, buffer[i].second);
+      }
+      remaining -= count;
+    }
+    ::close(fd);
+  }
+
+  // Hop distance from source to every vertex, UNREACHED if none. A
+  // pass relaxes every edge out of a labelled vertex, so labels can
+  // travel several hops in one pass when the file order allows it;
+  // the number of passes is at most the BFS depth plus one.
+  std::vector<unsigned int> bfs(vertex_type source) const {
+    assert(source < vertex_count_);
+    std::vector<unsigned int> level(vertex_count_, UNREACHED);
+    level[source] = 0;
+
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for_each_edge([&](vertex_type u, vertex_type v) {
+        if (level[u] != UNREACHED && level[u] + 1 < level[v]) {
+          level[v] = level[u] + 1;
+          changed = true;
+        }
+      });
+    }
+    return level;
+  }
+
+  // Weakly connected components in a single pass. Each vertex is
+  // labelled with the smallest vertex id in its component.
+  std::vector<vertex_type> connected_components() const {
+    std::vector<vertex_type> parent(vertex_count_);
+    std::iota(parent.begin(), parent.end(), 0);
+
+    auto find = [&](vertex_type u) {
+      while (parent[u] != u) {
+        parent[u] = parent[parent[u]];
+        u = parent[u];
+      }
+      return u;
+    };
+
+    for_each_edge([&](vertex_type u, vertex_type v) {
+      u = find(u);
+      v = find(v);
+      // linking the larger root under the smaller keeps every root
+      // the minimum of its component
+      if (u < v) {
+        parent[v] = u;
+      } else if (v < u) {
+        parent[u] = v;
+      }
+    });
+
+    for (vertex_type v = 0; v < vertex_count_; ++v) {
+      parent[v] = parent[parent[v]];
+    }
+    return parent;
+  }
+
+  // Kahn's algorithm one level per pass: a pass retires the current
+  // zero in-degree frontier and collects the next one. Throws if the
+  // edges contain a cycle.
+  std::vector<vertex_type> topsort() const {
+    enum State : unsigned char { WAITING, FRONTIER, NEXT, DONE };
+
+    std::vector<unsigned int> in_degree(vertex_count_, 0);
+    for_each_edge([&](vertex_type, vertex_type v) {
+      ++in_degree[v];
+    });
+
+    std::vector<vertex_type> result;
+    result.reserve(vertex_count_);
+    std::vector<State> state(vertex_count_, WAITING);
+    for (vertex_type v = 0; v < vertex_count_; ++v) {
+      if (in_degree[v] == 0) {
+        state[v] = FRONTIER;
+        result.push_back(v);
+      }
+    }
+
+    size_t frontier_begin = 0;
+    while (frontier_begin < result.size() && result.size() < vertex_count_) {
+      size_t frontier_end = result.size();
+      for_each_edge([&](vertex_type u, vertex_type v) {
+        if (state[u] == FRONTIER && --in_degree[v] == 0) {
+          state[v] = NEXT;
+          result.push_back(v);
+        }
+      });
+
+      for (size_t i = frontier_begin; i < frontier_end; ++i) {
+        state[result[i]] = DONE;
+      }
+      for (size_t i = frontier_end; i < result.size(); ++i) {
+        state[result[i]] = FRONTIER;
+      }
+      frontier_begin = frontier_end;
+    }
+
+    if (result.size() != vertex_count_) {
+      throw std::runtime_error("graph has a cycle");
+    }
+    return result;
+  }
+
+private:
+  std::string path_;
+  size_t vertex_count_;
+  uint64_t edge_count_;
+  size_t buffer_edges_;
+  mutable size_t passes_;
+
+  int open_file() const {
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("cannot open edge file " + path_);
+    }
+    return fd;
+  }
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_EXTERNAL_GRAPH_H */
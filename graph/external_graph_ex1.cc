@@ -0,0 +1,52 @@
+#include "external_graph.h"
+
+int main() {
+  fontus::DirectedAcyclicGraph g(10, true);
+
+  g.add_edge(8, 7, 3);
+  g.add_edge(8, 5, 6);
+  g.add_edge(7, 5, 2);
+  g.add_edge(7, 6, 3);
+  g.add_edge(5, 4, 4);
+  g.add_edge(5, 6, 2);
+  g.add_edge(6, 3, 5);
+  g.add_edge(5, 3, 3);
+  g.add_edge(6, 2, 2);
+  g.add_edge(4, 2, 2);
+  g.add_edge(1, 3, 1);
+  g.add_edge(2, 1, 1);
+  g.add_edge(1, 0, 2);
+
+  auto path = (std::filesystem::temp_directory_path() /
+               "fontus_dag_ex1.edges").string();
+  fontus::write_edge_file(path, g);
+
+  // A tiny buffer forces several reads per pass.
+  fontus::SemiExternalGraph eg(path, 32);
+  std::cout << eg.vertex_count() << " vertices and "
+            << eg.edge_count() << " edges\n";
+
+  auto sorted = eg.topsort();
+  for (const auto& v: sorted) {
+    std::cout << v << ',';
+  }
+  std::cout << '\n';
+
+  auto levels = eg.bfs(5);
+  for (fontus::vertex_type v = 0; v < levels.size(); ++v) {
+    std::cout << "level[" << v << "] = ";
+    if (levels[v] == fontus::SemiExternalGraph::UNREACHED) {
+      std::cout << "-\n";
+    } else {
+      std::cout << levels[v] << '\n';
+    }
+  }
+
+  auto components = eg.connected_components();
+  for (fontus::vertex_type v = 0; v < components.size(); ++v) {
+    std::cout << "component[" << v << "] = " << components[v] << '\n';
+  }
+  std::cout << eg.passes() << " passes over the edge file\n";
+
+  std::remove(path.c_str());
+}
@@ -3,6 +3,107 @@ using namespace std;
 
 class UndirectedGraph;
 
+unsigned default_concurrency() {
+  return max(1u, thread::hardware_concurrency());
+}
+
+// Calls func(begin, end) on `threads` contiguous slices of [0, count)
+// and waits for all of them to finish.
+template <typename Func>
+void parallel_for(size_t count, unsigned threads, Func func) {
+  threads = max<size_t>(1, min<size_t>(threads, count));
+  if (threads == 1) {
+    func(size_t(0), count);
+    return;
+  }
+
+  vector<thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back(func, count * t / threads, count * (t + 1) / threads);
+  }
+  for (auto& worker: workers) {
+    worker.join();
+  }
+}
+
+// Below this many elements parallel_sort sorts on one thread.
+const size_t PARALLEL_SORT_MIN = 1 << 16;
+
+// Sorts one chunk per thread, then merges neighbouring chunks
+// pairwise, doubling the run width on every pass.
+template <typename Iter, typename Compare>
+void parallel_sort(Iter first, Iter last, Compare cmp, unsigned threads) {
+  size_t count = last - first;
+  if (threads <= 1 || count < PARALLEL_SORT_MIN) {
+    sort(first, last, cmp);
+    return;
+  }
+
+  vector<Iter> bounds;
+  for (unsigned t = 0; t <= threads; ++t) {
+    bounds.push_back(first + count * t / threads);
+  }
+
+  parallel_for(threads, threads, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      sort(bounds[i], bounds[i + 1], cmp);
+    }
+  });
+
+  for (size_t width = 1; width < threads; width *= 2) {
+    vector<thread> workers;
+    for (size_t i = 0; i + width < threads; i += 2 * width) {
+      Iter lo = bounds[i], mid = bounds[i + width];
+      Iter hi = bounds[min<size_t>(i + 2 * width, threads)];
+      workers.emplace_back([=]() { inplace_merge(lo, mid, hi, cmp); });
+    }
+    for (auto& worker: workers) {
+      worker.join();
+    }
+  }
+}
+
+// Disjoint-set forest with union by rank and path compression.
+class DisjointSets {
+public:
+  DisjointSets(int size) : parent(max(size, 0)), ranks(max(size, 0), 0) {
+    iota(parent.begin(), parent.end(), 0);
+  }
+
+  int find(int u) {
+    int root = u;
+    while (parent[root] != root) {
+      root = parent[root];
+    }
+    while (parent[u] != root) {
+      int next = parent[u];
+      parent[u] = root;
+      u = next;
+    }
+    return root;
+  }
+
+  bool unite(int u, int v) {
+    u = find(u);
+    v = find(v);
+    if (u == v) {
+      return false;
+    }
+    if (ranks[u] < ranks[v]) {
+      swap(u, v);
+    }
+    parent[v] = u;
+    if (ranks[u] == ranks[v]) {
+      ++ranks[u];
+    }
+    return true;
+  }
+
+private:
+  vector<int> parent;
+  vector<unsigned char> ranks;
+};
+
 // Directed graph algorithms
 class DirectedGraph {
 public:
@@ -37,6 +138,10 @@ public:
     return edges;
   }
 
+  const set<int>& adjacent(int u) const {
+    return adj_list[u];
+  }
+
   // Depth first search on a directed graph
   void dfs(void (visit)(int vertex)) {
     vector<bool> visited(vertices, false);
@@ -180,6 +285,15 @@ public:
     return edges/2;
   }
 
+  const set<int>& adjacent(int u) const {
+    return dgraph.adjacent(u);
+  }
+
+  // Weight of the edge (u, v), 1 in an unweighted graph.
+  int weight(int u, int v) {
+    return weighted ? get_weight(u, v) : 1;
+  }
+
   // Depth first search on an undirected graph
   bool dfs(void (visit)(int vertex)) {
     vector<bool> visited(vertex_count(), false);
@@ -316,6 +430,97 @@ public:
     return result;
   }
 
+  // Each edge once, as ((u, v), weight) with u < v. Unweighted
+  // graphs report a weight of 1 for every edge.
+  vector<edge_type> edge_list() {
+    vector<edge_type> result;
+    result.reserve(edge_count());
+    for (int u = 0; u < vertex_count(); ++u) {
+      for (int v: dgraph.adj_list[u]) {
+        if (u < v) {
+          result.push_back(make_pair(make_pair(u, v),
+                                     weighted ? get_weight(u, v) : 1));
+        }
+      }
+    }
+    return result;
+  }
+
+  // Minimum spanning forest by Boruvka's algorithm. Every round finds
+  // the lightest edge leaving each component with one parallel pass
+  // over the remaining edges, then contracts along those edges.
+  vector<edge_type> msf_boruvka(unsigned threads = default_concurrency()) {
+    vector<edge_type> edges = edge_list();
+    assert(edges.size() < numeric_limits<uint32_t>::max());
+
+    const uint64_t none = numeric_limits<uint64_t>::max();
+    vector<edge_type> result;
+    DisjointSets sets(vertex_count());
+    vector<int> component(vertex_count());
+    vector<atomic<uint64_t>> cheapest(vertex_count());
+
+    // Order edges by (weight, index) so that every component agrees
+    // on a single lightest edge even when weights tie.
+    auto encode = [](int weight, size_t index) -> uint64_t {
+      return (uint64_t(uint32_t(weight) ^ 0x80000000u) << 32) | index;
+    };
+    auto store_min = [](atomic<uint64_t>& slot, uint64_t key) {
+      uint64_t current = slot.load(memory_order_relaxed);
+      while (key < current &&
+             !slot.compare_exchange_weak(current, key, memory_order_relaxed)) {
+      }
+    };
+
+    bool merged = true;
+    while (merged) {
+      merged = false;
+      for (int v = 0; v < vertex_count(); ++v) {
+        component[v] = sets.find(v);
+        cheapest[v].store(none, memory_order_relaxed);
+      }
+
+      // Edges inside a component can never be picked again.
+      edges.erase(remove_if(edges.begin(), edges.end(), [&](const edge_type& e) {
+        return component[e.first.first] == component[e.first.second];
+      }), edges.end());
+
+      parallel_for(edges.size(), threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          int cu = component[edges[i].first.first];
+          int cv = component[edges[i].first.second];
+          uint64_t key = encode(edges[i].second, i);
+          store_min(cheapest[cu], key);
+          store_min(cheapest[cv], key);
+        }
+      });
+
+      for (int v = 0; v < vertex_count(); ++v) {
+        uint64_t key = cheapest[v].load(memory_order_relaxed);
+        if (component[v] != v || key == none) {
+          continue;
+        }
+        const edge_type& e = edges[key & 0xffffffffu];
+        if (sets.unite(e.first.first, e.first.second)) {
+          result.push_back(e);
+          merged = true;
+        }
+      }
+    }
+
+    return result;
+  }
+
+  // Minimum spanning forest by filter-Kruskal: partition the edges
+  // around a pivot weight, solve the light half first and drop heavy
+  // edges whose ends are already connected before recursing on them.
+  vector<edge_type> msf_kruskal(unsigned threads = default_concurrency()) {
+    vector<edge_type> edges = edge_list();
+    vector<edge_type> result;
+    DisjointSets sets(vertex_count());
+    filter_kruskal(edges.begin(), edges.end(), sets, result, threads);
+    return result;
+  }
+
   friend bool operator==(UndirectedGraph& ug1, UndirectedGraph& ug2) {
     return true;
   }
@@ -398,6 +603,230 @@ private:
     }
     return *it;
   }
+
+  typedef vector<edge_type>::iterator edge_iterator;
+
+  // Slices are only split while larger than PARALLEL_SORT_MIN per
+  // thread, so that the sorted leaves are big enough for parallel_sort
+  // to use every thread.
+  void filter_kruskal(edge_iterator first, edge_iterator last,
+                      DisjointSets& sets, vector<edge_type>& result,
+                      unsigned threads) {
+    auto by_weight = [](const edge_type& e1, const edge_type& e2) {
+      return e1.second < e2.second;
+    };
+    auto connected = [&](const edge_type& e) {
+      return sets.find(e.first.first) == sets.find(e.first.second);
+    };
+
+    size_t count = last - first;
+    if (count == 0 || int(result.size()) + 1 >= vertex_count()) {
+      return;
+    }
+
+    edge_iterator mid = first;
+    if (count > PARALLEL_SORT_MIN * max(threads, 1u)) {
+      // median of three as the pivot weight
+      int w[3] = {first->second, (first + count / 2)->second,
+                  (last - 1)->second};
+      sort(w, w + 3);
+      int pivot = w[1];
+      mid = partition(first, last, [=](const edge_type& e) {
+        return e.second < pivot;
+      });
+      if (mid == first) {
+        mid = partition(first, last, [=](const edge_type& e) {
+          return e.second <= pivot;
+        });
+      }
+    }
+
+    if (mid == first || mid == last) {
+      parallel_sort(first, last, by_weight, threads);
+      for (auto it = first; it != last; ++it) {
+        if (sets.unite(it->first.first, it->first.second)) {
+          result.push_back(*it);
+        }
+      }
+      return;
+    }
+
+    filter_kruskal(first, mid, sets, result, threads);
+    edge_iterator heavy_end = remove_if(mid, last, connected);
+    filter_kruskal(mid, heavy_end, sets, result, threads);
+  }
+};
+
+// Constant-time lowest common ancestor and distance queries on a tree
+// (or forest) held in an UndirectedGraph. Built from an Euler tour of
+// every component, plus a sparse table over the tour that gives the
+// shallowest vertex between the first visits of two vertices.
+class TreeIndex {
+public:
+  TreeIndex(UndirectedGraph& tree, int root = 0)
+    : depth(tree.vertex_count(), -1),
+      distance_from_root(tree.vertex_count(), 0),
+      first_visit(tree.vertex_count(), -1),
+      component(tree.vertex_count(), -1) {
+    int n = tree.vertex_count();
+    int components = 0;
+    euler.reserve(max(2 * n - 1, 0));
+    if (n > 0) {
+      assert(root >= 0 && root < n);
+      build_tour(tree, root);
+      ++components;
+    }
+    for (int v = 0; v < n; ++v) {
+      if (depth[v] < 0) {
+        build_tour(tree, v);
+        ++components;
+      }
+    }
+    // The tours found a spanning forest; any edge beyond it closes a
+    // cycle.
+    if (tree.edge_count() != n - components) {
+      throw runtime_error("graph is not a tree");
+    }
+    build_table();
+  }
+
+  // Returns -1 when u and v lie in different trees of the forest.
+  int lca(int u, int v) const {
+    if (component[u] != component[v]) {
+      return -1;
+    }
+
+    int left = first_visit[u], right = first_visit[v];
+    if (left > right) {
+      swap(left, right);
+    }
+    return range_min(left, right);
+  }
+
+  // Sum of edge weights on the path between u and v, or -1 when they
+  // are not connected.
+  long long distance(int u, int v) const {
+    int ancestor = lca(u, v);
+    if (ancestor < 0) {
+      return -1;
+    }
+    return distance_from_root[u] + distance_from_root[v] -
+      2 * distance_from_root[ancestor];
+  }
+
+  // Number of edges on the path between u and v, or -1.
+  int hops(int u, int v) const {
+    int ancestor = lca(u, v);
+    if (ancestor < 0) {
+      return -1;
+    }
+    return depth[u] + depth[v] - 2 * depth[ancestor];
+  }
+
+  // Answers are returned in input order, but the queries are
+  // evaluated grouped by where their tour range starts so that
+  // consecutive lookups touch neighbouring sparse table entries.
+  vector<int> lca_batch(const vector<pair<int, int>>& queries) const {
+    vector<int> result(queries.size());
+    for (auto i: locality_order(queries)) {
+      result[i] = lca(queries[i].first, queries[i].second);
+    }
+    return result;
+  }
+
+  vector<long long> distance_batch(const vector<pair<int, int>>& queries) const {
+    vector<long long> result(queries.size());
+    for (auto i: locality_order(queries)) {
+      result[i] = distance(queries[i].first, queries[i].second);
+    }
+    return result;
+  }
+
+private:
+  vector<int> depth;
+  vector<long long> distance_from_root;
+  vector<int> first_visit;
+  vector<int> component;
+  vector<int> euler;
+  // table[k][i] is the shallowest vertex in euler[i, i + 2^k).
+  vector<vector<int>> table;
+
+  void build_tour(UndirectedGraph& tree, int root) {
+    // iterative so that path-like trees don't exhaust the stack
+    vector<pair<int, set<int>::const_iterator>> stack;
+    depth[root] = 0;
+    component[root] = root;
+    first_visit[root] = euler.size();
+    euler.push_back(root);
+    stack.emplace_back(root, tree.adjacent(root).begin());
+
+    while (!stack.empty()) {
+      int u = stack.back().first;
+      auto& next = stack.back().second;
+      if (next == tree.adjacent(u).end()) {
+        stack.pop_back();
+        if (!stack.empty()) {
+          euler.push_back(stack.back().first);
+        }
+        continue;
+      }
+
+      int v = *next++;
+      if (depth[v] >= 0) {
+        continue;
+      }
+      depth[v] = depth[u] + 1;
+      distance_from_root[v] = distance_from_root[u] + tree.weight(u, v);
+      component[v] = root;
+      first_visit[v] = euler.size();
+      euler.push_back(v);
+      stack.emplace_back(v, tree.adjacent(v).begin());
+    }
+  }
+
+  void build_table() {
+    table.push_back(euler);
+    for (size_t k = 1; (size_t(1) << k) <= euler.size(); ++k) {
+      const vector<int>& prev = table.back();
+      size_t half = size_t(1) << (k - 1);
+      vector<int> level(euler.size() - 2 * half + 1);
+      for (size_t i = 0; i < level.size(); ++i) {
+        level[i] = shallower(prev[i], prev[i + half]);
+      }
+      table.push_back(move(level));
+    }
+  }
+
+  int shallower(int u, int v) const {
+    return depth[u] <= depth[v] ? u : v;
+  }
+
+  int range_min(int left, int right) const {
+    int k = 31 - __builtin_clz(right - left + 1);
+    return shallower(table[k][left], table[k][right - (1 << k) + 1]);
+  }
+
+  // Counting sort of the query indices by the block of the tour
+  // their range starts in.
+  vector<size_t> locality_order(const vector<pair<int, int>>& queries) const {
+    const int block_shift = 6;
+    size_t blocks = (euler.size() >> block_shift) + 1;
+    vector<size_t> offsets(blocks + 1, 0);
+    auto block_of = [&](const pair<int, int>& q) {
+      return size_t(min(first_visit[q.first], first_visit[q.second])) >>
+        block_shift;
+    };
+
+    for (auto& q: queries) {
+      ++offsets[block_of(q) + 1];
+    }
+    partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    vector<size_t> order(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+      order[offsets[block_of(queries[i])]++] = i;
+    }
+    return order;
+  }
 };
 
 int main() {
@@ -513,6 +942,46 @@ int main() {
 
   auto mst = udg1.mst_prim();
 
+  for (auto& msf: {udg1.msf_boruvka(), udg1.msf_kruskal()}) {
+    int msf_cost = 0;
+    for (auto& e: msf) {
+      cout << "(" << e.first.first << ", " << e.first.second << ") ";
+      msf_cost += e.second;
+    }
+    cout << "\nMin cost: " << msf_cost << '\n';
+  }
+
+  // A graph large enough for filter-Kruskal to sort on several threads.
+  const int big_vertices = 1 << 17;
+  UndirectedGraph big(big_vertices, true);
+  mt19937 rng(1);
+  for (int v = 1; v < big_vertices; ++v) {
+    big.add_edge(v, rng() % v, rng() % 1000);
+  }
+  while (big.edge_count() < 600000) {
+    int u = rng() % big_vertices, v = rng() % big_vertices;
+    if (u != v) {
+      big.add_edge(u, v, rng() % 1000);
+    }
+  }
+  auto forest_cost = [](const vector<UndirectedGraph::edge_type>& msf) {
+    long long cost = 0;
+    for (auto& e: msf) {
+      cost += e.second;
+    }
+    return cost;
+  };
+  long long threaded_cost = forest_cost(big.msf_kruskal(4));
+  long long sequential_cost = forest_cost(big.msf_kruskal(1));
+  long long boruvka_cost = forest_cost(big.msf_boruvka());
+  cout << "Kruskal on " << big.edge_count() << " edges: cost "
+       << threaded_cost << " on 4 threads, " << sequential_cost
+       << " on 1, Boruvka cost " << boruvka_cost << '\n';
+  if (threaded_cost != sequential_cost || threaded_cost != boruvka_cost) {
+    cout << "Parallel Kruskal check failed\n";
+    return 1;
+  }
+
   /*        3
         0 ----- 1              2 ----- 1
      6 /        | 2                    |
@@ -556,4 +1025,32 @@ int main() {
   cout << '\n';
 
   cout << udg_tree.is_isomorphic(udg2_tree) << '\n';
+
+  TreeIndex index(udg_tree);
+  vector<pair<int, int>> queries = {{2, 6}, {4, 5}, {0, 2}, {6, 6}};
+  auto ancestors = index.lca_batch(queries);
+  auto distances = index.distance_batch(queries);
+  for (size_t i = 0; i < queries.size(); ++i) {
+    cout << "lca(" << queries[i].first << ", " << queries[i].second
+         << ") = " << ancestors[i] << ", distance = " << distances[i] << '\n';
+  }
+
+  // A path deep enough to overflow a recursive traversal.
+  const int path_length = 200000;
+  UndirectedGraph path(path_length);
+  for (int v = 1; v < path_length; ++v) {
+    path.add_edge(v - 1, v);
+  }
+  TreeIndex path_index(path);
+  cout << "hops(0, " << path_length - 1 << ") = "
+       << path_index.hops(0, path_length - 1) << '\n';
+
+  path.add_edge(0, path_length - 1);
+  try {
+    TreeIndex cycle_index(path);
+    cout << "Cycle not detected\n";
+    return 1;
+  } catch (const runtime_error& e) {
+    cout << "Cycle rejected: " << e.what() << '\n';
+  }
 }
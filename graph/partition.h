@@ -0,0 +1,632 @@
+#ifndef FONTUS_PARTITION_H
+#define FONTUS_PARTITION_H
+
+#include <bits/stdc++.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "graph/dag.h"
+
+namespace fontus {
+
+typedef unsigned int shard_type;
+
+enum class PartitionHeuristic {
+  LDG,     // linear deterministic greedy
+  FENNEL
+};
+
+// Streaming vertex partitioner. Vertices are visited once in id order
+// and placed on the shard holding most of their already placed
+// neighbours (both edge directions count), discounted by how full the
+// shard is. No shard grows beyond (1 + slack) * V / k vertices.
+//
+// Graph is anything with vertex_count() and adjacent(u) returning the
+// out-neighbours of u, e.g. DirectedAcyclicGraph.
+template <typename Graph>
+std::vector<shard_type> partition_graph(const Graph& graph, shard_type k,
+    PartitionHeuristic heuristic = PartitionHeuristic::LDG,
+    double slack = 0.1) {
+  assert(k > 0);
+  size_t n = graph.vertex_count();
+
+  // In-neighbours as CSR, so both directions are visible while
+  // streaming.
+  std::vector<size_t> in_offsets(n + 1, 0);
+  for (size_t u = 0; u < n; ++u) {
+    for (auto v: graph.adjacent(u)) {
+      ++in_offsets[v + 1];
+    }
+  }
+  std::partial_sum(in_offsets.begin(), in_offsets.end(), in_offsets.begin());
+  size_t m = in_offsets[n];
+  std::vector<vertex_type> in_targets(m);
+  std::vector<size_t> fill(in_offsets.begin(), in_offsets.end() - 1);
+  for (size_t u = 0; u < n; ++u) {
+    for (auto v: graph.adjacent(u)) {
+      in_targets[fill[v]++] = u;
+    }
+  }
+
+  const shard_type UNASSIGNED = std::numeric_limits<shard_type>::max();
+  double capacity = std::max(1.0, std::ceil((1.0 + slack) * n / k));
+  double gamma = 1.5;
+  double alpha = n > 0 ? std::sqrt(double(k)) * m / std::pow(double(n), gamma) : 0;
+
+  std::vector<shard_type> assignment(n, UNASSIGNED);
+  std::vector<size_t> load(k, 0);
+  std::vector<size_t> common(k, 0);
+
+  for (size_t v = 0; v < n; ++v) {
+    std::fill(common.begin(), common.end(), 0);
+    for (auto w: graph.adjacent(v)) {
+      if (assignment[w] != UNASSIGNED) {
+        ++common[assignment[w]];
+      }
+    }
+    for (size_t i = in_offsets[v]; i < in_offsets[v + 1]; ++i) {
+      if (assignment[in_targets[i]] != UNASSIGNED) {
+        ++common[assignment[in_targets[i]]];
+      }
+    }
+
+    shard_type best = UNASSIGNED;
+    double best_score = 0;
+    for (shard_type s = 0; s < k; ++s) {
+      if (load[s] >= capacity) {
+        continue;
+      }
+      double score = (heuristic == PartitionHeuristic::LDG) ?
+        common[s] * (1.0 - load[s] / capacity) :
+        common[s] - alpha * gamma * std::pow(double(load[s]), gamma - 1);
+      if (best == UNASSIGNED || score > best_score ||
+          (score == best_score && load[s] < load[best])) {
+        best = s;
+        best_score = score;
+      }
+    }
+    assert(best != UNASSIGNED);
+    assignment[v] = best;
+    ++load[best];
+  }
+
+  return assignment;
+}
+
+// One shard of a partitioned directed graph in CSR form. Local
+// vertices are numbered 0..n-1; an edge target t >= n refers to ghost
+// slot t - n, a copy of a vertex owned by another shard. The mirror
+// table lists, for every local vertex, the (shard, ghost slot) pairs
+// under which other shards hold it as a ghost.
+struct GraphShard {
+  static constexpr uint64_t MAGIC = 0x44524148534e4f46ull;  // "FONSHARD"
+
+  shard_type shard;
+  shard_type shard_count;
+  uint64_t global_vertex_count;
+
+  std::vector<vertex_type> local_to_global;
+  std::vector<uint64_t> offsets;
+  std::vector<uint32_t> targets;
+
+  std::vector<vertex_type> ghost_global;
+  std::vector<shard_type> ghost_owner;
+  std::vector<uint32_t> ghost_owner_index;
+
+  std::vector<uint64_t> mirror_offsets;
+  std::vector<shard_type> mirror_shard;
+  std::vector<uint32_t> mirror_slot;
+
+  size_t vertex_count() const {
+    return local_to_global.size();
+  }
+
+  size_t ghost_count() const {
+    return ghost_global.size();
+  }
+
+  void save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    uint64_t header[] = {MAGIC, shard, shard_count, global_vertex_count,
+      local_to_global.size(), targets.size(), ghost_global.size(),
+      mirror_shard.size()};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    write_array(out, local_to_global);
+    write_array(out, offsets);
+    write_array(out, targets);
+    write_array(out, ghost_global);
+    write_array(out, ghost_owner);
+    write_array(out, ghost_owner_index);
+    write_array(out, mirror_offsets);
+    write_array(out, mirror_shard);
+    write_array(out, mirror_slot);
+    if (!out) {
+      throw std::runtime_error("cannot write shard " + path);
+    }
+  }
+
+  static GraphShard load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    uint64_t header[8];
+    in.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!in || header[0] != MAGIC) {
+      throw std::runtime_error("not a shard file: " + path);
+    }
+
+    GraphShard result;
+    result.shard = header[1];
+    result.shard_count = header[2];
+    result.global_vertex_count = header[3];
+    read_array(in, result.local_to_global, header[4]);
+    read_array(in, result.offsets, header[4] + 1);
+    read_array(in, result.targets, header[5]);
+    read_array(in, result.ghost_global, header[6]);
+    read_array(in, result.ghost_owner, header[6]);
+    read_array(in, result.ghost_owner_index, header[6]);
+    read_array(in, result.mirror_offsets, header[4] + 1);
+    read_array(in, result.mirror_shard, header[7]);
+    read_array(in, result.mirror_slot, header[7]);
+    if (!in) {
+      throw std::runtime_error("truncated shard file " + path);
+    }
+    return result;
+  }
+
+private:
+  template <typename T>
+  static void write_array(std::ofstream& out, const std::vector<T>& data) {
+    out.write(reinterpret_cast<const char*>(data.data()),
+              data.size() * sizeof(T));
+  }
+
+  template <typename T>
+  static void read_array(std::ifstream& in, std::vector<T>& data, size_t count) {
+    data.resize(count);
+    in.read(reinterpret_cast<char*>(data.data()), count * sizeof(T));
+  }
+};
+
+// Splits graph into shards by assignment and writes them as
+// <prefix>-<i>.shard, returning the file names.
+template <typename Graph>
+std::vector<std::string> write_shards(const Graph& graph,
+                                      const std::vector<shard_type>& assignment,
+                                      shard_type k, const std::string& prefix) {
+  size_t n = graph.vertex_count();
+  assert(assignment.size() == n);
+
+  std::vector<GraphShard> shards(k);
+  std::vector<uint32_t> local_index(n);
+  for (shard_type s = 0; s < k; ++s) {
+    shards[s].shard = s;
+    shards[s].shard_count = k;
+    shards[s].global_vertex_count = n;
+    shards[s].offsets.push_back(0);
+  }
+  for (size_t v = 0; v < n; ++v) {
+    GraphShard& shard = shards[assignment[v]];
+    local_index[v] = shard.local_to_global.size();
+    shard.local_to_global.push_back(v);
+  }
+
+  // Edges and ghost slots, plus the reverse direction for mirrors:
+  // mirrors[s][local] lists (shard, slot) pairs holding it as a ghost.
+  std::vector<std::vector<std::vector<std::pair<shard_type, uint32_t>>>> mirrors(k);
+  for (shard_type s = 0; s < k; ++s) {
+    mirrors[s].resize(shards[s].vertex_count());
+  }
+
+  for (shard_type s = 0; s < k; ++s) {
+    GraphShard& shard = shards[s];
+    std::unordered_map<vertex_type, uint32_t> ghost_slot;
+    for (vertex_type u: shard.local_to_global) {
+      for (auto v: graph.adjacent(u)) {
+        shard_type owner = assignment[v];
+        if (owner == s) {
+          shard.targets.push_back(local_index[v]);
+          continue;
+        }
+        auto result = ghost_slot.emplace(v, shard.ghost_global.size());
+        if (result.second) {
+          shard.ghost_global.push_back(v);
+          shard.ghost_owner.push_back(owner);
+          shard.ghost_owner_index.push_back(local_index[v]);
+          mirrors[owner][local_index[v]].emplace_back(s, result.first->second);
+        }
+        // ghost targets are numbered after the local vertices
+        shard.targets.push_back(shard.vertex_count() + result.first->second);
+      }
+      shard.offsets.push_back(shard.targets.size());
+    }
+  }
+
+  std::vector<std::string> paths;
+  for (shard_type s = 0; s < k; ++s) {
+    GraphShard& shard = shards[s];
+    shard.mirror_offsets.push_back(0);
+    for (auto& entries: mirrors[s]) {
+      for (auto& entry: entries) {
+        shard.mirror_shard.push_back(entry.first);
+        shard.mirror_slot.push_back(entry.second);
+      }
+      shard.mirror_offsets.push_back(shard.mirror_shard.size());
+    }
+    paths.push_back(prefix + "-" + std::to_string(s) + ".shard");
+    shard.save(paths.back());
+  }
+  return paths;
+}
+
+// Runs bulk-synchronous algorithms over shard files with one forked
+// worker process per shard. Each worker talks to this (coordinator)
+// process over a Unix socket pair; in every superstep the workers
+// send their outgoing updates, the coordinator routes them to their
+// destination shards and ends the run once a superstep produces no
+// updates and no worker has pending work.
+class ShardedRunner {
+public:
+  static constexpr unsigned int UNREACHED =
+    std::numeric_limits<unsigned int>::max();
+
+  explicit ShardedRunner(std::vector<std::string> shard_paths) :
+    paths_(std::move(shard_paths)) {
+    if (paths_.empty()) {
+      throw std::runtime_error("no shards");
+    }
+    GraphShard first = GraphShard::load(paths_[0]);
+    if (first.shard_count != paths_.size()) {
+      throw std::runtime_error("shard count mismatch");
+    }
+    vertex_count_ = first.global_vertex_count;
+  }
+
+  // Hop distance from source, UNREACHED if none.
+  std::vector<unsigned int> bfs(vertex_type source) const {
+    assert(source < vertex_count_);
+    return run(UNREACHED, [source](const GraphShard& shard, Channel& channel) {
+      return bfs_worker(shard, channel, source);
+    });
+  }
+
+  // Weakly connected components, each vertex labelled with the
+  // smallest vertex id in its component.
+  std::vector<vertex_type> connected_components() const {
+    return run(0, [](const GraphShard& shard, Channel& channel) {
+      return components_worker(shard, channel);
+    });
+  }
+
+private:
+  enum Target : uint32_t { OWNED, GHOST };
+  enum FrameType : uint32_t { UPDATES, DONE, RESULT };
+
+  struct Update {
+    shard_type shard;
+    uint32_t target;  // Target
+    uint32_t index;
+    uint32_t value;
+  };
+
+  struct FrameHeader {
+    uint32_t type;    // FrameType
+    uint32_t active;
+    uint64_t count;
+  };
+
+  // Framed messages over one end of a socket pair.
+  class Channel {
+  public:
+    explicit Channel(int fd) : fd_(fd) {}
+
+    template <typename T>
+    void send(FrameType type, bool active, const std::vector<T>& items) {
+      FrameHeader header{type, active, items.size()};
+      write_all(&header, sizeof(header));
+      write_all(items.data(), items.size() * sizeof(T));
+    }
+
+    template <typename T>
+    FrameHeader receive(std::vector<T>& items) {
+      FrameHeader header;
+      read_all(&header, sizeof(header));
+      items.resize(header.count);
+      read_all(items.data(), header.count * sizeof(T));
+      return header;
+    }
+
+  private:
+    int fd_;
+
+    void write_all(const void* data, size_t size) {
+      const char* p = static_cast<const char*>(data);
+      while (size > 0) {
+        ssize_t done = ::write(fd_, p, size);
+        if (done < 0 && errno == EINTR) {
+          continue;
+        }
+        if (done <= 0) {
+          throw std::runtime_error("shard channel write failed");
+        }
+        p += done;
+        size -= done;
+      }
+    }
+
+    void read_all(void* data, size_t size) {
+      char* p = static_cast<char*>(data);
+      while (size > 0) {
+        ssize_t done = ::read(fd_, p, size);
+        if (done < 0 && errno == EINTR) {
+          continue;
+        }
+        if (done <= 0) {
+          throw std::runtime_error("shard channel read failed");
+        }
+        p += done;
+        size -= done;
+      }
+    }
+  };
+
+  std::vector<std::string> paths_;
+  size_t vertex_count_;
+
+  // Worker: a superstep exchange. Returns false once the coordinator
+  // has declared the run finished.
+  static bool exchange(Channel& channel, bool active,
+                       std::vector<Update>& outgoing,
+                       std::vector<Update>& incoming) {
+    channel.send(UPDATES, active, outgoing);
+    outgoing.clear();
+    return channel.receive(incoming).type != DONE;
+  }
+
+  static void send_result(Channel& channel, const GraphShard& shard,
+                          const std::vector<uint32_t>& values) {
+    std::vector<std::pair<vertex_type, uint32_t>> result;
+    for (size_t v = 0; v < shard.vertex_count(); ++v) {
+      result.emplace_back(shard.local_to_global[v], values[v]);
+    }
+    channel.send(RESULT, false, result);
+  }
+
+  static void bfs_worker(const GraphShard& shard, Channel& channel,
+                         vertex_type source) {
+    size_t n = shard.vertex_count();
+    std::vector<uint32_t> level(n, UNREACHED);
+    std::vector<bool> ghost_sent(shard.ghost_count(), false);
+    std::vector<uint32_t> frontier, next;
+    std::vector<Update> outgoing, incoming;
+
+    for (size_t v = 0; v < n; ++v) {
+      if (shard.local_to_global[v] == source) {
+        level[v] = 0;
+        frontier.push_back(v);
+      }
+    }
+
+    for (uint32_t depth = 0; ; ++depth) {
+      for (uint32_t u: frontier) {
+        for (size_t i = shard.offsets[u]; i < shard.offsets[u + 1]; ++i) {
+          uint32_t t = shard.targets[i];
+          if (t < n) {
+            if (level[t] == UNREACHED) {
+              level[t] = depth + 1;
+              next.push_back(t);
+            }
+          } else if (!ghost_sent[t - n]) {
+            // the first level sent for a ghost is its smallest
+            ghost_sent[t - n] = true;
+            outgoing.push_back(Update{shard.ghost_owner[t - n], OWNED,
+                                      shard.ghost_owner_index[t - n], depth + 1});
+          }
+        }
+      }
+
+      if (!exchange(channel, !next.empty(), outgoing, incoming)) {
+        break;
+      }
+      for (auto& update: incoming) {
+        if (level[update.index] == UNREACHED) {
+          level[update.index] = update.value;
+          next.push_back(update.index);
+        }
+      }
+      frontier.swap(next);
+      next.clear();
+    }
+
+    send_result(channel, shard, level);
+  }
+
+  // Minimum-label propagation. Local vertices and ghosts connected by
+  // local edges are grouped once with a union-find, so a superstep
+  // settles each group in one sweep; only label decreases cross
+  // shard boundaries: ghosts report to their owner, owners to their
+  // mirrors.
+  static void components_worker(const GraphShard& shard, Channel& channel) {
+    size_t n = shard.vertex_count(), g = shard.ghost_count();
+    std::vector<uint32_t> parent(n + g);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](uint32_t u) {
+      while (parent[u] != u) {
+        parent[u] = parent[parent[u]];
+        u = parent[u];
+      }
+      return u;
+    };
+    for (uint32_t u = 0; u < n; ++u) {
+      for (size_t i = shard.offsets[u]; i < shard.offsets[u + 1]; ++i) {
+        parent[find(u)] = find(shard.targets[i]);
+      }
+    }
+    for (uint32_t u = 0; u < n + g; ++u) {
+      parent[u] = find(u);
+    }
+
+    std::vector<uint32_t> label(n + g);
+    for (size_t v = 0; v < n; ++v) {
+      label[v] = shard.local_to_global[v];
+    }
+    for (size_t j = 0; j < g; ++j) {
+      label[n + j] = shard.ghost_global[j];
+    }
+    // last label each side is known to have seen
+    std::vector<uint32_t> shared(label);
+    std::vector<uint32_t> group_min(n + g);
+    std::vector<Update> outgoing, incoming;
+
+    while (true) {
+      std::fill(group_min.begin(), group_min.end(), UNREACHED);
+      for (uint32_t u = 0; u < n + g; ++u) {
+        group_min[parent[u]] = std::min(group_min[parent[u]], label[u]);
+      }
+      for (uint32_t u = 0; u < n + g; ++u) {
+        label[u] = group_min[parent[u]];
+      }
+
+      for (uint32_t v = 0; v < n; ++v) {
+        if (label[v] < shared[v]) {
+          shared[v] = label[v];
+          for (size_t i = shard.mirror_offsets[v]; i < shard.mirror_offsets[v + 1]; ++i) {
+            outgoing.push_back(Update{shard.mirror_shard[i], GHOST,
+                                      shard.mirror_slot[i], label[v]});
+          }
+        }
+      }
+      for (uint32_t j = 0; j < g; ++j) {
+        if (label[n + j] < shared[n + j]) {
+          shared[n + j] = label[n + j];
+          outgoing.push_back(Update{shard.ghost_owner[j], OWNED,
+                                    shard.ghost_owner_index[j], label[n + j]});
+        }
+      }
+
+      if (!exchange(channel, false, outgoing, incoming)) {
+        break;
+      }
+      for (auto& update: incoming) {
+        uint32_t u = (update.target == OWNED) ? update.index : n + update.index;
+        label[u] = std::min(label[u], update.value);
+        if (update.target == GHOST) {
+          // the owner already knows
+          shared[u] = std::min(shared[u], update.value);
+        }
+      }
+    }
+
+    send_result(channel, shard, label);
+  }
+
+  template <typename Worker>
+  std::vector<uint32_t> run(uint32_t initial, Worker worker) const {
+    shard_type k = paths_.size();
+    std::vector<int> fds;
+    std::vector<pid_t> pids;
+
+    for (shard_type s = 0; s < k; ++s) {
+      int pair[2];
+      if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+        reap(fds, pids);
+        throw std::runtime_error("socketpair failed");
+      }
+      pid_t pid = ::fork();
+      if (pid < 0) {
+        ::close(pair[0]);
+        ::close(pair[1]);
+        reap(fds, pids);
+        throw std::runtime_error("fork failed");
+      }
+      if (pid == 0) {
+        ::close(pair[0]);
+        for (int fd: fds) {
+          ::close(fd);
+        }
+        int status = 0;
+        try {
+          GraphShard shard = GraphShard::load(paths_[s]);
+          Channel channel(pair[1]);
+          worker(shard, channel);
+        } catch (...) {
+          status = 1;
+        }
+        ::_exit(status);
+      }
+      ::close(pair[1]);
+      fds.push_back(pair[0]);
+      pids.push_back(pid);
+    }
+
+    std::vector<uint32_t> result(vertex_count_, initial);
+    bool failed = false;
+    try {
+      coordinate(fds, result);
+    } catch (...) {
+      failed = true;
+    }
+
+    if (!reap(fds, pids) || failed) {
+      throw std::runtime_error("shard worker failed");
+    }
+    return result;
+  }
+
+  // Closes the parent ends of the channels, so that workers still
+  // reading from them see end of file and exit, then waits for every
+  // worker. Returns whether all of them exited cleanly.
+  static bool reap(const std::vector<int>& fds,
+                   const std::vector<pid_t>& pids) {
+    for (int fd: fds) {
+      ::close(fd);
+    }
+    bool clean = true;
+    for (pid_t pid: pids) {
+      int status = 0;
+      ::waitpid(pid, &status, 0);
+      clean = clean && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+    return clean;
+  }
+
+  void coordinate(const std::vector<int>& fds,
+                  std::vector<uint32_t>& result) const {
+    shard_type k = fds.size();
+    std::vector<Channel> channels;
+    for (int fd: fds) {
+      channels.emplace_back(fd);
+    }
+
+    std::vector<std::vector<Update>> routed(k);
+    std::vector<Update> batch;
+    bool running = true;
+    while (running) {
+      bool active = false;
+      for (shard_type s = 0; s < k; ++s) {
+        FrameHeader header = channels[s].receive(batch);
+        active = active || header.active || !batch.empty();
+        for (auto& update: batch) {
+          routed[update.shard].push_back(update);
+        }
+      }
+      running = active;
+      for (shard_type s = 0; s < k; ++s) {
+        channels[s].send(running ? UPDATES : DONE, false, routed[s]);
+        routed[s].clear();
+      }
+    }
+
+    std::vector<std::pair<vertex_type, uint32_t>> values;
+    for (shard_type s = 0; s < k; ++s) {
+      if (channels[s].receive(values).type != RESULT) {
+        throw std::runtime_error("unexpected frame from shard worker");
+      }
+      for (auto& value: values) {
+        result[value.first] = value.second;
+      }
+    }
+  }
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_PARTITION_H */
@@ -0,0 +1,64 @@
+#include "partition.h"
+#include "external_graph.h"
+
+int main() {
+  const unsigned int n = 2000;
+  const fontus::shard_type k = 4;
+
+  // Random DAG with id locality: most edges point a few ids ahead, a
+  // few jump further, and vertices >= 1900 are left isolated.
+  std::mt19937 rng(42);
+  fontus::DirectedAcyclicGraph g(n, false);
+  for (unsigned int u = 0; u < 1900; ++u) {
+    for (int i = 0; i < 3; ++i) {
+      unsigned int reach = (rng() % 20 == 0) ? 1900 : 8;
+      unsigned int v = u + 1 + rng() % reach;
+      if (v < 1900) {
+        g.add_edge(u, v);
+      }
+    }
+  }
+
+  auto dir = std::filesystem::temp_directory_path();
+  auto edge_path = (dir / "fontus_partition_ex1.edges").string();
+  fontus::write_edge_file(edge_path, g);
+  fontus::SemiExternalGraph reference(edge_path);
+
+  for (auto heuristic: {fontus::PartitionHeuristic::LDG,
+                        fontus::PartitionHeuristic::FENNEL}) {
+    auto assignment = fontus::partition_graph(g, k, heuristic);
+
+    std::vector<size_t> load(k, 0);
+    size_t cut = 0, edges = 0;
+    for (unsigned int u = 0; u < n; ++u) {
+      ++load[assignment[u]];
+      for (auto v: g.adjacent(u)) {
+        ++edges;
+        cut += assignment[u] != assignment[v];
+      }
+    }
+    std::cout << (heuristic == fontus::PartitionHeuristic::LDG ? "LDG" : "Fennel")
+              << ": cut " << cut << " of " << edges << " edges, loads";
+    for (auto l: load) {
+      std::cout << ' ' << l;
+    }
+    std::cout << '\n';
+
+    auto paths = fontus::write_shards(g, assignment, k,
+                                      (dir / "fontus_partition_ex1").string());
+    fontus::ShardedRunner runner(paths);
+
+    auto levels = runner.bfs(0);
+    std::cout << "BFS matches: " << (levels == reference.bfs(0)) << '\n';
+
+    auto components = runner.connected_components();
+    std::cout << "Components match: "
+              << (components == reference.connected_components()) << '\n';
+
+    for (auto& path: paths) {
+      std::remove(path.c_str());
+    }
+  }
+
+  std::remove(edge_path.c_str());
+}
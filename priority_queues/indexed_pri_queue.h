@@ -2,146 +2,318 @@
 #define INDEXED_PRI_QUEUE
 
 #include <bits/stdc++.h>
+#include "common/flat_hash_map.h"
 
 namespace fontus {
 
-template <typename T, typename U = int>
+// Priority queue addressable by key. As with std::priority_queue, the
+// top is the element that Compare orders last, so the default
+// std::less gives a max-queue and std::greater a min-queue.
+//
+// The heap is Arity-ary: a node's children sit next to each other, so
+// with a 4- or 8-ary heap one sift-down step compares a whole cache
+// line of siblings and the tree is half or a third as deep as a
+// binary heap. Each heap slot holds the priority together with the
+// key id it belongs to, so a sift touches a single array.
+//
+// Keys may be of any type Hash and KeyEqual accept. Lookups by key
+// are heterogeneous when both are transparent, e.g. a std::string
+// keyed queue can be probed with a std::string_view.
+template <typename T, typename U = int, unsigned Arity = 2,
+	typename Compare = std::less<U>, typename Hash = FlatHash<T>,
+	typename KeyEqual = std::equal_to<>>
 class IndexedPriorityQueue {
+	static_assert(Arity >= 2, "a heap needs at least two children per node");
+
 public:
-	IndexedPriorityQueue(int initial_size) {
-		id_to_key.reserve(initial_size);
-		heap.reserve(initial_size);
-		id_to_pos.reserve(initial_size);
-		pos_to_id.reserve(initial_size);
+	IndexedPriorityQueue(int initial_size, Compare compare = Compare())
+		: compare(std::move(compare)) {
+		reserve(initial_size);
+		id_pool.reserve(initial_size);
 	}
 
-	bool push(const T& key, U value) {
-		if (key.empty() || !value) {
+	// Returns false if the key is already queued.
+	bool push(T key, U value) {
+		int key_id = acquire_id(std::move(key));
+		if (key_id < 0) {
 			return false;
 		}
-
-		int key_id = 0;
-		if (id_pool.begin() == id_pool.end()) {
-			key_id = heap.size();
-		} else {
-			key_id = *id_pool.begin();
-			id_pool.erase(id_pool.begin());
-		}
-		key_to_id.insert({key, key_id});
-		if (key_id >= id_to_key.size()) {
-			// This happens when we have not handed this key_id out earlier
-			id_to_key.push_back(key);
-			assert(id_to_key.size() == key_id + 1);
-		} else {
-			// This happens when we reuse a key_id from the pool
-			id_to_key[key_id] = key;
-		}
-		heap.push_back(value);
+		heap.push_back(Entry{std::move(value), key_id});
 		id_to_pos[key_id] = heap.size() - 1;
-		pos_to_id[heap.size() - 1] = key_id;
 
-		for (int i = heap.size() - 1; i > 0; i /= 2) {
-			if (heap[i] <= heap[i/2]) {
-				break;
+		sift_up(heap.size() - 1);
+		return true;
+	}
+
+	// Pushes a range of (key, priority) pairs, skipping keys that are
+	// already queued. The tables are sized once for the whole batch,
+	// and a batch large enough that k sifts would cost more than
+	// rebuilding is appended unordered and heapified in O(n). Returns
+	// the number of keys pushed.
+	template <typename Iter>
+	size_t push_batch(Iter first, Iter last) {
+		size_t count = std::distance(first, last);
+		reserve(heap.size() + count);
+
+		bool rebuild = rebuild_cheaper(count, heap.size() + count);
+		size_t pushed = 0;
+		for (; first != last; ++first) {
+			int key_id = acquire_id(T(first->first));
+			if (key_id < 0) {
+				continue;
 			}
-			heap_swap(i, i/2);
+			heap.push_back(Entry{U(first->second), key_id});
+			id_to_pos[key_id] = heap.size() - 1;
+			if (!rebuild) {
+				sift_up(heap.size() - 1);
+			}
+			++pushed;
 		}
-		return true;
+		if (rebuild) {
+			heapify();
+		}
+		return pushed;
 	}
 
 	std::optional<std::pair<T, U>> pop() {
 		if (heap.empty()) {
 			return std::nullopt;
 		}
-		return remove(0);
+		return remove_at(0);
 	}
 
-	std::optional<std::pair<T, U>> remove(const T& key) {
+	std::optional<std::pair<T, U>> top() const {
 		if (heap.empty()) {
 			return std::nullopt;
 		}
-		auto iter = key_to_id.find(key);
-		if (iter == key_to_id.end()) {
+		return std::make_pair(id_to_key[heap[0].id], heap[0].priority);
+	}
+
+	// The priority at the top, without copying its key.
+	std::optional<U> top_priority() const {
+		if (heap.empty()) {
 			return std::nullopt;
 		}
+		return heap[0].priority;
+	}
 
-		int key_id = iter->second;
-		return remove(id_to_pos[key_id]);
+	template <typename K>
+	std::optional<std::pair<T, U>> remove(const K& key) {
+		const int* key_id = key_to_id.find(key);
+		if (!key_id) {
+			return std::nullopt;
+		}
+		return remove_at(id_to_pos[*key_id]);
 	}
 
-	std::optional<U> query_priority(const T& key) const {
-		auto iter = key_to_id.find(key);
-		if (iter == key_to_id.end()) {
+	template <typename K>
+	bool contains(const K& key) const {
+		return key_to_id.contains(key);
+	}
+
+	template <typename K>
+	std::optional<U> query_priority(const K& key) const {
+		const int* key_id = key_to_id.find(key);
+		if (!key_id) {
 			return std::nullopt;
 		}
 
-		int key_id = iter->second;
-		assert(id_to_pos[key_id] < heap.size());
-		return heap[id_to_pos[key_id]];
+		assert(size_t(id_to_pos[*key_id]) < heap.size());
+		return heap[id_to_pos[*key_id]].priority;
 	}
 
-	void update_priority(const T& key, U value);
+	// Raises or lowers the priority of a queued key. Returns false if
+	// the key is not in the queue.
+	template <typename K>
+	bool update_priority(const K& key, U value) {
+		const int* key_id = key_to_id.find(key);
+		if (!key_id) {
+			return false;
+		}
+
+		int pos = id_to_pos[*key_id];
+		bool raised = compare(heap[pos].priority, value);
+		heap[pos].priority = std::move(value);
+		if (raised) {
+			sift_up(pos);
+		} else {
+			sift_down(pos);
+		}
+		return true;
+	}
+
+	// Updates the priorities of a range of (key, priority) pairs,
+	// skipping keys that are not queued. Large batches are written in
+	// place and the heap rebuilt once, as in push_batch. Returns the
+	// number of keys updated.
+	template <typename Iter>
+	size_t update_batch(Iter first, Iter last) {
+		if (!rebuild_cheaper(std::distance(first, last), heap.size())) {
+			size_t updated = 0;
+			for (; first != last; ++first) {
+				updated += update_priority(first->first, first->second);
+			}
+			return updated;
+		}
+
+		size_t updated = 0;
+		for (; first != last; ++first) {
+			const int* key_id = key_to_id.find(first->first);
+			if (key_id) {
+				heap[id_to_pos[*key_id]].priority = first->second;
+				++updated;
+			}
+		}
+		heapify();
+		return updated;
+	}
+
+	// Makes room for count keys.
+	void reserve(size_t count) {
+		key_to_id.reserve(count);
+		id_to_key.reserve(count);
+		heap.reserve(count);
+		id_to_pos.reserve(count);
+	}
+
+	size_t size() const {
+		return heap.size();
+	}
+
+	bool empty() const {
+		return heap.empty();
+	}
 
 private:
+	struct Entry {
+		U priority;
+		int id;
+	};
+
+	Compare compare;
+
 	// map keys to an incremental key id
-	std::unordered_map<T, int> key_to_id;
+	FlatHashMap<T, int, Hash, KeyEqual> key_to_id;
 
 	// reverse map the key ids to keys
 	std::vector<T> id_to_key;
 
 	// actual heap data structure
-	std::vector<U> heap;
+	std::vector<Entry> heap;
 
 	// map key ids to position in heap
 	std::vector<int> id_to_pos;
 
-	// map position in heap to key ids
-	std::vector<int> pos_to_id;
-
 	// Spare key ids for popped elements
 	// for reuse
-	std::set<int> id_pool;
+	std::vector<int> id_pool;
 
-	// Swap two elements in the heap at positions i and j.
-	void heap_swap(int i, int j) noexcept {
-		std::swap(heap[i], heap[j]);
-		int key_i = pos_to_id[i];
-		int key_j = pos_to_id[j];
-		pos_to_id[i] = key_j;
-		pos_to_id[j] = key_i;
-		id_to_pos[key_j] = i;
-		id_to_pos[key_i] = j;
+	static size_t parent(size_t pos) {
+		return (pos - 1) / Arity;
 	}
 
-	// Remove the element at position pos in the heap.
-	std::optional<std::pair<T, U>> remove(int pos) {
-		int priority = heap[pos];
-		int key_id = pos_to_id[pos];
-
-		heap[pos] = heap.back();
-		heap.pop_back();
-		pos_to_id[pos] = pos_to_id[heap.size()];
-		id_to_pos[pos_to_id[pos]] = pos;
-
-		for (int i = pos; 2*i + 1 < heap.size(); ) {
-			if (heap[i] >= heap[2*i + 1] && (heap.size() <= 2*i + 2
-				|| heap[i] >= heap[2*i + 2])) {
-				break;
+	static size_t first_child(size_t pos) {
+		return Arity * pos + 1;
+	}
+
+	// Maps a new key to a key id, reusing a spare one if there is
+	// any. Returns -1 if the key is already queued.
+	int acquire_id(T key) {
+		int key_id = id_pool.empty() ? id_to_key.size() : id_pool.back();
+		if (!key_to_id.emplace(key, key_id).second) {
+			return -1;
+		}
+
+		if (id_pool.empty()) {
+			// This happens when we have not handed this key_id out earlier
+			id_to_key.push_back(std::move(key));
+			id_to_pos.push_back(0);
+			assert(id_to_key.size() == size_t(key_id) + 1);
+		} else {
+			// This happens when we reuse a key_id from the pool
+			id_pool.pop_back();
+			id_to_key[key_id] = std::move(key);
+		}
+		return key_id;
+	}
+
+	// Whether count sifts, O(log n) each, would cost more than
+	// heapifying all n entries.
+	static bool rebuild_cheaper(size_t count, size_t n) {
+		size_t log_n = 1;
+		while ((size_t(1) << log_n) < n) {
+			++log_n;
+		}
+		return count * log_n > n;
+	}
+
+	// Floyd's bottom-up heap construction, O(n) for any arity.
+	void heapify() {
+		if (heap.size() < 2) {
+			return;
+		}
+		for (size_t pos = parent(heap.size() - 1) + 1; pos-- > 0;) {
+			sift_down(pos);
+		}
+	}
+
+	// Store entry at position pos and record where its key went.
+	void place(size_t pos, Entry&& entry) {
+		id_to_pos[entry.id] = pos;
+		heap[pos] = std::move(entry);
+	}
+
+	// Both sifts carry the entry along as a hole and write it once at
+	// its final position.
+	void sift_up(size_t pos) {
+		Entry entry = std::move(heap[pos]);
+		while (pos > 0 && compare(heap[parent(pos)].priority, entry.priority)) {
+			place(pos, std::move(heap[parent(pos)]));
+			pos = parent(pos);
+		}
+		place(pos, std::move(entry));
+	}
+
+	void sift_down(size_t pos) {
+		Entry entry = std::move(heap[pos]);
+		while (first_child(pos) < heap.size()) {
+			size_t first = first_child(pos);
+			size_t last = std::min<size_t>(first + Arity, heap.size());
+			size_t best = first;
+			for (size_t child = first + 1; child < last; ++child) {
+				if (compare(heap[best].priority, heap[child].priority)) {
+					best = child;
+				}
 			}
-			int j = 2*i + 2;
-			if (j >= heap.size() || heap[j-1] > heap[j]) {
-				j = j-1;
+			if (!compare(entry.priority, heap[best].priority)) {
+				break;
 			}
-			heap_swap(i, j);
-			i = j;
+			place(pos, std::move(heap[best]));
+			pos = best;
 		}
+		place(pos, std::move(entry));
+	}
 
-		T key = id_to_key[key_id];
-		id_pool.insert(key_id);
-		id_to_key[key_id] = "";
-		key_to_id.erase(key);
+	// Remove the element at position pos in the heap.
+	std::optional<std::pair<T, U>> remove_at(size_t pos) {
+		Entry removed = std::move(heap[pos]);
+
+		if (pos + 1 < heap.size()) {
+			// the element moved in from the back may belong
+			// above or below pos
+			heap[pos] = std::move(heap.back());
+			heap.pop_back();
+			sift_down(pos);
+			sift_up(pos);
+		} else {
+			heap.pop_back();
+		}
 
-		return std::make_pair(key, priority);
+		int key_id = removed.id;
+		key_to_id.erase(id_to_key[key_id]);
+		id_pool.push_back(key_id);
+		return std::make_pair(std::move(id_to_key[key_id]),
+			std::move(removed.priority));
 	}
 };
 
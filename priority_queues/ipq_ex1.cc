@@ -33,4 +33,59 @@ int main() {
 		std::cout << std::get<0>(val.value_or(
 					std::make_pair(std::string("[]"), 0))) << " popped\n";
 	}
+
+	fontus::IndexedPriorityQueue<std::string, int, 4> ipq4(10);
+	ipq4.push("hello", 1);
+	ipq4.push("welcome", 2);
+	ipq4.push("good morning", 3);
+	ipq4.push("hola", 4);
+	ipq4.push("bongiorno", 5);
+	ipq4.update_priority("hello", 10);
+	ipq4.update_priority("bongiorno", 0);
+
+	for (auto val = ipq4.pop(); val; val = ipq4.pop()) {
+		std::cout << val->first << " popped with priority "
+			      << val->second << '\n';
+	}
+
+	std::string_view key = "good morning";
+	ipq.push("good morning", 0);
+	std::cout << "Priority for " << key << " is "
+		      << ipq.query_priority(key).value_or(-1) << '\n';
+
+	fontus::IndexedPriorityQueue<uint64_t, int> ids(10);
+	ids.push(1ull << 40, 3);
+	ids.push(7, 0);
+	ids.push(42, -2);
+	ids.update_priority(42, 5);
+	for (auto val = ids.pop(); val; val = ids.pop()) {
+		std::cout << val->first << " popped with priority "
+			      << val->second << '\n';
+	}
+
+	// Min-queue of 64-bit deadlines.
+	fontus::IndexedPriorityQueue<int, uint64_t, 4, std::greater<uint64_t>>
+		timeouts(10);
+	timeouts.push(1, 1700000000123456789ull);
+	timeouts.push(2, 1700000000000000001ull);
+	timeouts.push(3, 1800000000000000000ull);
+	timeouts.update_priority(3, 1600000000000000000ull);
+	for (auto val = timeouts.pop(); val; val = timeouts.pop()) {
+		std::cout << "timer " << val->first << " expires at "
+			      << val->second << '\n';
+	}
+
+	// One tick of counters, pushed and then refreshed in batches.
+	std::vector<std::pair<std::string, int>> tick = {
+		{"cpu", 71}, {"disk", 12}, {"net", 40}, {"mem", 55}, {"cpu", 0}};
+	fontus::IndexedPriorityQueue<std::string> metrics(10);
+	std::cout << metrics.push_batch(tick.begin(), tick.end())
+		      << " metrics pushed\n";
+	std::vector<std::pair<std::string, int>> next_tick = {
+		{"disk", 90}, {"net", 5}, {"gpu", 99}};
+	std::cout << metrics.update_batch(next_tick.begin(), next_tick.end())
+		      << " metrics updated\n";
+	for (auto val = metrics.pop(); val; val = metrics.pop()) {
+		std::cout << val->first << " at " << val->second << '\n';
+	}
 }
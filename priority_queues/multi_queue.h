@@ -0,0 +1,153 @@
+#ifndef FONTUS_MULTI_QUEUE_H
+#define FONTUS_MULTI_QUEUE_H
+
+#include "pairing_heap.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fontus {
+
+// Relaxed concurrent priority queue (the MultiQueue of Rihani, Sanders
+// and Dementiev). Elements are spread over c * threads sequential
+// pairing heaps, each behind its own lock. push locks a random heap;
+// pop samples two heaps and pops from the one with the better top. A
+// pop thus returns an element near, though not always at, the global
+// top. The expected rank error grows linearly with the number of
+// heaps, so a larger c trades accuracy for less lock contention.
+//
+// Cmp has the same meaning as for PairingHeap: Cmp(a, b) is true if a
+// is popped before b. Each heap publishes its top key through an
+// atomic so that pop can compare heaps without locking them, hence
+// keys must be trivially copyable.
+template <typename Key, typename Value, typename Cmp = std::greater<Key>>
+class MultiQueue {
+	static_assert(std::is_trivially_copyable<Key>::value,
+		"MultiQueue keys are published through std::atomic");
+
+public:
+	typedef std::pair<Key, Value> value_type;
+
+	// threads is the number of threads expected to use the queue and
+	// c the number of heaps per thread.
+	explicit MultiQueue(unsigned threads, unsigned c = 2)
+		: queues(std::max(2u, std::max(1u, c) * std::max(1u, threads))) {}
+
+	size_t queue_count() const {
+		return queues.size();
+	}
+
+	void push(Key key, Value value) {
+		for (;;) {
+			Queue& queue = queues[random_index()];
+			std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+			if (!lock) {
+				continue;
+			}
+			queue.heap.push(value_type(key, std::move(value)));
+			queue.publish();
+			return;
+		}
+	}
+
+	// Returns std::nullopt only if every heap was seen empty.
+	std::optional<value_type> pop() {
+		size_t misses = 0;
+		for (;;) {
+			Queue* queue = better(&queues[random_index()],
+				&queues[random_index()]);
+			if (!queue) {
+				if (++misses < queues.size()) {
+					continue;
+				}
+				// Sampling keeps finding empty heaps: look at all of
+				// them before reporting the queue as empty.
+				queue = any_nonempty();
+				if (!queue) {
+					return std::nullopt;
+				}
+				misses = 0;
+			}
+
+			std::unique_lock<std::mutex> lock(queue->mutex, std::try_to_lock);
+			if (!lock || queue->heap.empty()) {
+				continue;
+			}
+			value_type result = queue->heap.pop();
+			queue->publish();
+			return result;
+		}
+	}
+
+private:
+	struct EntryCmp {
+		bool operator()(const value_type& a, const value_type& b) const {
+			return Cmp()(a.first, b.first);
+		}
+	};
+
+	// Cache line aligned so that threads working on neighbouring
+	// heaps do not contend for the same line.
+	struct alignas(64) Queue {
+		std::mutex mutex;
+		PairingHeap<value_type, EntryCmp> heap;
+		// Updated under the lock, read without it.
+		std::atomic<Key> top_key{};
+		std::atomic<bool> nonempty{false};
+
+		void publish() {
+			if (heap.empty()) {
+				nonempty.store(false, std::memory_order_relaxed);
+			} else {
+				top_key.store(heap.top().first, std::memory_order_relaxed);
+				nonempty.store(true, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	std::vector<Queue> queues;
+
+	static Queue* better(Queue* a, Queue* b) {
+		bool a_full = a->nonempty.load(std::memory_order_relaxed);
+		bool b_full = b->nonempty.load(std::memory_order_relaxed);
+		if (!a_full || !b_full) {
+			return a_full ? a : (b_full ? b : nullptr);
+		}
+		Key a_key = a->top_key.load(std::memory_order_relaxed);
+		Key b_key = b->top_key.load(std::memory_order_relaxed);
+		return Cmp()(b_key, a_key) ? b : a;
+	}
+
+	Queue* any_nonempty() {
+		for (auto& queue: queues) {
+			if (queue.nonempty.load(std::memory_order_relaxed)) {
+				return &queue;
+			}
+		}
+		return nullptr;
+	}
+
+	// xorshift64* per thread, mapped onto [0, queue_count()) with a
+	// multiply instead of a division.
+	size_t random_index() {
+		static std::atomic<uint64_t> seeds{0x9e3779b97f4a7c15ull};
+		thread_local uint64_t state =
+			(seeds.fetch_add(0x9e3779b97f4a7c15ull) ^
+			 std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		uint32_t random = (state * 0x2545f4914f6cdd1dull) >> 32;
+		return (uint64_t(random) * queues.size()) >> 32;
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_MULTI_QUEUE_H */
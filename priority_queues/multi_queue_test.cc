@@ -0,0 +1,155 @@
+#include "multi_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Measures how far MultiQueue pops stray from the true minimum, and
+// compares its throughput with a mutex around std::priority_queue.
+// Usage: multi_queue_test [elements] [max threads]
+
+typedef chrono::steady_clock Clock;
+typedef fontus::MultiQueue<unsigned, unsigned, less<unsigned>> MinQueue;
+
+// Counts the keys still queued below a popped key.
+class RankCounter {
+public:
+	explicit RankCounter(size_t n) : tree(n + 1, 0) {
+		for (size_t i = 1; i <= n; ++i) {
+			tree[i] += 1;
+			if (i + (i & -i) <= n) {
+				tree[i + (i & -i)] += tree[i];
+			}
+		}
+	}
+
+	// Removes key and returns the number of smaller keys left.
+	size_t remove(size_t key) {
+		size_t rank = 0;
+		for (size_t i = key; i > 0; i -= i & -i) {
+			rank += tree[i];
+		}
+		for (size_t i = key + 1; i < tree.size(); i += i & -i) {
+			tree[i] -= 1;
+		}
+		return rank;
+	}
+
+private:
+	vector<size_t> tree;
+};
+
+// Pushes a permutation of 0..n-1 and pops everything, single threaded.
+void rank_error(size_t n, unsigned threads, unsigned c) {
+	vector<unsigned> keys(n);
+	iota(keys.begin(), keys.end(), 0);
+	shuffle(keys.begin(), keys.end(), mt19937(12345));
+
+	MinQueue queue(threads, c);
+	for (auto key: keys) {
+		queue.push(key, key);
+	}
+
+	RankCounter ranks(n);
+	size_t popped = 0, total = 0, worst = 0;
+	while (auto entry = queue.pop()) {
+		if (entry->first != entry->second) {
+			cout << "corrupted entry " << entry->first << '\n';
+			exit(1);
+		}
+		size_t rank = ranks.remove(entry->first);
+		total += rank;
+		worst = max(worst, rank);
+		++popped;
+	}
+	if (popped != n) {
+		cout << "popped " << popped << " of " << n << '\n';
+		exit(1);
+	}
+
+	cout << "  " << setw(3) << queue.queue_count() << " heaps (c = " << c
+	     << "): mean rank error " << fixed << setprecision(2)
+	     << double(total) / n << ", max " << worst << '\n';
+}
+
+// Hold model: every thread starts with its share of n keys, then pops
+// one and pushes a slightly larger one back, ops times.
+template <typename Queue>
+double hold(Queue& queue, unsigned threads, size_t n, size_t ops) {
+	vector<thread> workers;
+	auto start = Clock::now();
+	for (unsigned t = 0; t < threads; ++t) {
+		workers.emplace_back([&queue, t, threads, n, ops]() {
+			mt19937 rng(t);
+			for (size_t i = t; i < n; i += threads) {
+				queue.push(rng() % n, i);
+			}
+			for (size_t i = 0; i < ops / threads; ++i) {
+				auto entry = queue.pop();
+				if (entry) {
+					queue.push(entry->first + rng() % 1024, entry->second);
+				}
+			}
+		});
+	}
+	for (auto& worker: workers) {
+		worker.join();
+	}
+	return chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The baseline: one std::priority_queue behind one mutex.
+class LockedQueue {
+public:
+	void push(unsigned key, unsigned value) {
+		lock_guard<mutex> lock(mutex_);
+		queue.emplace(key, value);
+	}
+
+	optional<pair<unsigned, unsigned>> pop() {
+		lock_guard<mutex> lock(mutex_);
+		if (queue.empty()) {
+			return nullopt;
+		}
+		auto top = queue.top();
+		queue.pop();
+		return top;
+	}
+
+private:
+	mutex mutex_;
+	priority_queue<pair<unsigned, unsigned>, vector<pair<unsigned, unsigned>>,
+		greater<pair<unsigned, unsigned>>> queue;
+};
+
+int main(int argc, char* argv[]) {
+	size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (1 << 18);
+	unsigned max_threads = (argc > 2) ? strtoul(argv[2], nullptr, 10)
+		: max(1u, thread::hardware_concurrency());
+
+	cout << "Rank error over " << n << " pops, sized for 8 threads\n";
+	for (unsigned c: {1, 2, 4, 8}) {
+		rank_error(n, 8, c);
+	}
+
+	size_t ops = 4 * n;
+	cout << "\nHold model, " << ops << " pop/push pairs (Mops/s)\n";
+	for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+		MinQueue multi(threads);
+		LockedQueue locked;
+		double multi_time = hold(multi, threads, n, ops);
+		double locked_time = hold(locked, threads, n, ops);
+		cout << "  " << setw(3) << threads << " threads: multiqueue "
+		     << fixed << setprecision(2) << ops / multi_time / 1e6
+		     << ", locked std::priority_queue " << ops / locked_time / 1e6
+		     << '\n';
+	}
+}
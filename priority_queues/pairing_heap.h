@@ -1,50 +1,271 @@
+#ifndef FONTUS_PAIRING_HEAP_H
+#define FONTUS_PAIRING_HEAP_H
+
 #include <vector>
 #include <memory>
 #include <algorithm>
 #include <ostream>
+#include <stdexcept>
+#include <type_traits>
 
 namespace fontus {
 
+// Sub-heaps hang off a node as an intrusive list: child points to the
+// first sub-heap and each sub-heap points to the next via sibling.
+// prev points back to the previous sibling, or to the parent for a
+// first child, so any node can be cut out in O(1).
 template <typename T>
 struct PairingHeapNode {
-	typedef std::unique_ptr<PairingHeapNode<T>> Ptr;
-
 	T value;
-	std::vector<Ptr> sub_heaps;
+	PairingHeapNode* child;
+	PairingHeapNode* sibling;
+	PairingHeapNode* prev;
 
-	PairingHeapNode(T value) : value{value} {}
-	PairingHeapNode(PairingHeapNode&&) = default;
-	PairingHeapNode& operator=(PairingHeapNode&&) = default;
+	template <typename... Args>
+	PairingHeapNode(Args&&... args) : value(std::forward<Args>(args)...),
+		child{}, sibling{}, prev{} {}
 
+	// Prints the subtree in preorder. A heap can degenerate into a chain
+	// as deep as it is large, so the walk keeps its own stack: an entry
+	// stands for a node and the siblings after it.
 	void print(std::ostream& ostr) const {
 		ostr << value << '\n';
-		for (auto& node: sub_heaps) {
-			node->print(ostr);
+		std::vector<const PairingHeapNode*> pending;
+		if (child) {
+			pending.push_back(child);
+		}
+		while (!pending.empty()) {
+			const PairingHeapNode* node = pending.back();
+			pending.pop_back();
+			ostr << node->value << '\n';
+			if (node->sibling) {
+				pending.push_back(node->sibling);
+			}
+			if (node->child) {
+				pending.push_back(node->child);
+			}
 		}
 	}
 };
 
-template <typename T, typename Cmp = std::greater<T>>
+// Slab allocator for fixed-size nodes. Freed nodes go on an intrusive
+// free list and are handed out again before a new slab is allocated,
+// so a pool whose live node count stays bounded stops allocating once
+// it has warmed up.
+template <typename Node>
+class NodePool {
+public:
+	NodePool() : free_list{}, free_tail{}, next_slab_size{64} {}
+
+	NodePool(NodePool&& that) noexcept : slabs(std::move(that.slabs)),
+		free_list{that.free_list}, free_tail{that.free_tail},
+		next_slab_size{that.next_slab_size} {
+		that.release();
+	}
+
+	NodePool& operator=(NodePool&& that) noexcept {
+		if (this != &that) {
+			slabs = std::move(that.slabs);
+			free_list = that.free_list;
+			free_tail = that.free_tail;
+			next_slab_size = that.next_slab_size;
+			that.release();
+		}
+		return *this;
+	}
+
+	template <typename... Args>
+	Node* create(Args&&... args) {
+		if (!free_list) {
+			grow(next_slab_size);
+			next_slab_size = std::min<size_t>(2*next_slab_size, 1 << 16);
+		}
+
+		Slot* slot = free_list;
+		Slot* next = slot->next;
+		Node* node = new (slot->storage) Node(std::forward<Args>(args)...);
+		free_list = next;
+		if (!free_list) {
+			free_tail = nullptr;
+		}
+		return node;
+	}
+
+	void destroy(Node* node) noexcept {
+		node->~Node();
+		Slot* slot = reinterpret_cast<Slot*>(node);
+		slot->next = free_list;
+		free_list = slot;
+		if (!free_tail) {
+			free_tail = slot;
+		}
+	}
+
+	// Adds one slab with room for count more nodes.
+	void add_slab(size_t count) {
+		if (count > 0) {
+			grow(count);
+		}
+	}
+
+	// Takes over all of that pool's memory, including nodes that are
+	// still live, so they can be handed over between heaps.
+	void splice(NodePool& that) noexcept {
+		std::move(that.slabs.begin(), that.slabs.end(),
+			std::back_inserter(slabs));
+		if (that.free_list) {
+			that.free_tail->next = free_list;
+			if (!free_tail) {
+				free_tail = that.free_tail;
+			}
+			free_list = that.free_list;
+		}
+		that.release();
+	}
+
+private:
+	union Slot {
+		Slot* next;
+		alignas(Node) unsigned char storage[sizeof(Node)];
+	};
+
+	std::vector<std::unique_ptr<Slot[]>> slabs;
+	Slot* free_list;
+	Slot* free_tail;
+	size_t next_slab_size;
+
+	void grow(size_t count) {
+		slabs.push_back(std::make_unique<Slot[]>(count));
+		Slot* slab = slabs.back().get();
+		for (size_t i = 0; i + 1 < count; ++i) {
+			slab[i].next = &slab[i + 1];
+		}
+		slab[count - 1].next = free_list;
+		if (!free_list) {
+			free_tail = &slab[count - 1];
+		}
+		free_list = slab;
+	}
+
+	void release() noexcept {
+		slabs.clear();
+		free_list = free_tail = nullptr;
+		next_slab_size = 64;
+	}
+};
+
+// How the sub-heaps of a popped root are combined.
+enum class PairingStrategy {
+	// Link neighbours left to right, then fold right to left.
+	TWO_PASS,
+	// Link neighbours in FIFO rounds until one heap is left.
+	MULTIPASS,
+	// Two-pass, but pushes collect in an auxiliary list that is only
+	// combined (multipass) and linked with the root on the next pop
+	// (Stasko and Vitter), which keeps insert-heavy phases cheap.
+	AUXILIARY_TWO_PASS
+};
+
+template <typename T, typename Cmp = std::greater<T>,
+	PairingStrategy Strategy = PairingStrategy::TWO_PASS>
 class PairingHeap {
+	typedef PairingHeapNode<T> Node;
+	static constexpr bool AUXILIARY =
+		(Strategy == PairingStrategy::AUXILIARY_TWO_PASS);
+
 public:
-	PairingHeap() : root{}, size_{0} {}
+	// Refers to an element from push until it is popped or erased.
+	// Nodes never move, so handles stay valid across other operations,
+	// including merging the heap into another one.
+	class Handle {
+	public:
+		Handle() : node{} {}
+
+		const T& value() const {
+			return node->value;
+		}
+
+		explicit operator bool() const {
+			return node != nullptr;
+		}
+
+		friend bool operator==(Handle h1, Handle h2) {
+			return h1.node == h2.node;
+		}
+
+	private:
+		friend class PairingHeap;
+		Node* node;
+
+		explicit Handle(Node* node) : node{node} {}
+	};
+
+	PairingHeap() : root{}, aux{}, aux_best{}, size_{0} {}
+
+	PairingHeap(T value) : PairingHeap() {
+		push(std::move(value));
+	}
+
+	// Builds a heap from a range in O(n): all nodes come from one slab
+	// and are combined with n - 1 links.
+	template <typename Iter>
+	PairingHeap(Iter first, Iter last) : PairingHeap() {
+		pool.add_slab(std::distance(first, last));
+		Node* head = nullptr;
+		for (; first != last; ++first) {
+			Node* node = pool.create(*first);
+			node->sibling = head;
+			head = node;
+			++size_;
+		}
+		root = multipass(head);
+	}
+
+	PairingHeap(PairingHeap&& that) noexcept : pool(std::move(that.pool)),
+		root{that.root}, aux{that.aux}, aux_best{that.aux_best},
+		size_{that.size_} {
+		that.root = that.aux = that.aux_best = nullptr;
+		that.size_ = 0;
+	}
 
-	PairingHeap(T value) : root(std::make_unique<PairingHeapNode<T>>(value)),
-		size_{1} {}
+	PairingHeap& operator=(PairingHeap&& that) noexcept {
+		if (this != &that) {
+			clear();
+			pool = std::move(that.pool);
+			root = that.root;
+			aux = that.aux;
+			aux_best = that.aux_best;
+			size_ = that.size_;
+			that.root = that.aux = that.aux_best = nullptr;
+			that.size_ = 0;
+		}
+		return *this;
+	}
 
-	PairingHeap(PairingHeap&&) = default;
-	PairingHeap& operator=(PairingHeap&&) = default;
+	~PairingHeap() {
+		// The pool releases the memory wholesale; only values with a
+		// destructor need the walk.
+		if (!std::is_trivially_destructible<T>::value) {
+			clear();
+		}
+	}
 
 	std::ostream& print(std::ostream& ostr) const {
 		ostr << "<<<<\n";
 		if (root) {
 			root->print(ostr);
 		}
+		for (auto node = aux; node; node = node->sibling) {
+			node->print(ostr);
+		}
 		ostr << ">>>>\n";
 		return ostr;
 	}
 
-	T top() const {
+	const T& top() const {
+		if (AUXILIARY && aux_best && Cmp()(aux_best->value, root->value)) {
+			return aux_best->value;
+		}
 		return root->value;
 	}
 
@@ -56,23 +277,71 @@ public:
 		return size_;
 	}
 
-	void merge(PairingHeap<T, Cmp>& that) {
-		if (empty() && !that.empty()) {
-			root = std::move(that.root);
-		} else if (!empty() && !that.empty()) {
-			if (Cmp()(root->value, that.root->value)) {
-				root->sub_heaps.push_back(std::move(that.root));
-			} else {
-				that.root->sub_heaps.push_back(std::move(root));
-				root = std::move(that.root);
-			}
+	// Moves all elements of that into this heap, leaving that empty.
+	void merge(PairingHeap& that) {
+		if (this == &that || that.empty()) {
+			return;
 		}
+
+		consolidate();
+		that.consolidate();
+		pool.splice(that.pool);
+		root = root ? link(root, that.root) : that.root;
+		size_ += that.size_;
+		that.root = nullptr;
+		that.size_ = 0;
 	}
 
-	void push(T value) {
-		PairingHeap<T, Cmp> new_heap(value);
-		this->merge(new_heap);
+	Handle push(T value) {
+		Node* node = pool.create(std::move(value));
+		if (!root) {
+			root = node;
+		} else if (AUXILIARY) {
+			node->sibling = aux;
+			aux = node;
+			if (!aux_best || Cmp()(node->value, aux_best->value)) {
+				aux_best = node;
+			}
+		} else {
+			root = link(root, node);
+		}
 		++size_;
+		return Handle(node);
+	}
+
+	// Moves an element towards the top: value must not compare worse
+	// than the current one. The node's subtree is cut off and linked
+	// back with the root, O(1) amortized.
+	void decrease_key(Handle handle, T value) {
+		Node* node = handle.node;
+		if (Cmp()(node->value, value)) {
+			throw std::runtime_error("New key is further from the top");
+		}
+
+		consolidate();
+		node->value = std::move(value);
+		if (node != root) {
+			cut(node);
+			root = link(root, node);
+		}
+	}
+
+	// Removes an arbitrary element, O(log n) amortized.
+	void erase(Handle handle) {
+		consolidate();
+		Node* node = handle.node;
+		if (node == root) {
+			pop();
+			return;
+		}
+
+		cut(node);
+		Node* rest = merge_pairs(node->child);
+		if (rest) {
+			root = link(root, rest);
+		}
+		pool.destroy(node);
+		--size_;
 	}
 
 	T pop() {
@@ -80,62 +349,149 @@ public:
 			throw std::runtime_error("Underflow error");
 		}
 
-		T result = root->value;
-		root = merge_pairs(root->sub_heaps);
+		consolidate();
+		T result = std::move(root->value);
+		Node* old_root = root;
+		root = merge_pairs(root->child);
+		pool.destroy(old_root);
 		--size_;
 
 		return result;
 	}
 
+	// Destroys all elements without recursion: a node with children
+	// is rotated behind its first child until it is a leaf.
+	void clear() noexcept {
+		consolidate();
+		Node* pending = root;
+		while (pending) {
+			Node* node = pending;
+			if (node->child) {
+				Node* first = node->child;
+				node->child = first->sibling;
+				first->sibling = node;
+				pending = first;
+			} else {
+				pending = node->sibling;
+				pool.destroy(node);
+			}
+		}
+		root = nullptr;
+		size_ = 0;
+	}
+
 private:
-	typedef typename PairingHeapNode<T>::Ptr PtrType;
-	PtrType root;
+	NodePool<Node> pool;
+	Node* root;
+	// Pending pushes for AUXILIARY_TWO_PASS, and the best among them.
+	Node* aux;
+	Node* aux_best;
 	size_t size_;
 
-	PairingHeap(PtrType node) : root(move(node)) {}
-
-	PtrType merge_pairs(std::vector<PtrType>& heaps) {
-		int sz = heaps.size();
-		bool merge_done = (sz <= 1);
-
-		while (!merge_done) {
-			int j = 0;
-
-			for (int i = 0; i < sz; i += 2) {
-				if (i == sz - 1) {
-					if (j < i) {
-						heaps[j++] = std::move(heaps[i]);
-					} else {
-						++j;
-					}
-					continue;
-				}
-
-				if (Cmp()(heaps[i]->value, heaps[i+1]->value)) {
-					heaps[i]->sub_heaps.push_back(std::move(heaps[i+1]));
-					if (j < i) {
-						heaps[j++] = std::move(heaps[i]);
-					} else {
-						++j;
-					}
-				} else {
-					heaps[i+1]->sub_heaps.push_back(std::move(heaps[i]));
-					heaps[j++] = std::move(heaps[i+1]);
-				}
-			}
-			sz = j;
-			merge_done = (sz <= 1); // one elem remaining
+	void consolidate() {
+		if (AUXILIARY && aux) {
+			root = link(root, multipass(aux));
+			aux = aux_best = nullptr;
 		}
+	}
+
+	// Links two roots: the loser becomes the winner's first child.
+	static Node* link(Node* first, Node* second) {
+		if (Cmp()(second->value, first->value)) {
+			std::swap(first, second);
+		}
+		second->sibling = first->child;
+		if (first->child) {
+			first->child->prev = second;
+		}
+		second->prev = first;
+		first->child = second;
+		first->prev = nullptr;
+		return first;
+	}
 
-		if (sz > 0) {
-			heaps.erase(heaps.begin() + sz, heaps.end());
-			return std::move(heaps[0]);
+	// Detaches a non-root node, with its subtree, from its parent.
+	static void cut(Node* node) {
+		if (node->prev->child == node) {
+			node->prev->child = node->sibling;
 		} else {
-			heaps.erase(heaps.begin(), heaps.end());
-			return PtrType{};
+			node->prev->sibling = node->sibling;
+		}
+		if (node->sibling) {
+			node->sibling->prev = node->prev;
+		}
+		node->sibling = node->prev = nullptr;
+	}
+
+	static Node* merge_pairs(Node* first) {
+		if (Strategy == PairingStrategy::MULTIPASS) {
+			return multipass(first);
+		}
+		return two_pass(first);
+	}
+
+	static Node* two_pass(Node* first) {
+		if (!first) {
+			return nullptr;
+		}
+
+		Node* pairs = nullptr;
+		while (first) {
+			Node* left = first;
+			Node* right = left->sibling;
+			if (!right) {
+				left->sibling = pairs;
+				pairs = left;
+				break;
+			}
+			first = right->sibling;
+			left->sibling = right->sibling = nullptr;
+			Node* winner = link(left, right);
+			winner->sibling = pairs;
+			pairs = winner;
+		}
+
+		Node* result = pairs;
+		pairs = pairs->sibling;
+		result->sibling = nullptr;
+		while (pairs) {
+			Node* next = pairs->sibling;
+			pairs->sibling = nullptr;
+			result = link(result, pairs);
+			pairs = next;
+		}
+		return result;
+	}
+
+	// Links the two heaps at the front of the list and appends the
+	// result at the back until a single heap remains.
+	static Node* multipass(Node* first) {
+		if (!first) {
+			return nullptr;
+		}
+
+		Node* last = first;
+		while (last->sibling) {
+			last = last->sibling;
+		}
+		while (first != last) {
+			Node* left = first;
+			Node* right = left->sibling;
+			first = right->sibling;
+			left->sibling = right->sibling = nullptr;
+			Node* winner = link(left, right);
+			if (!first) {
+				first = winner;
+			} else {
+				last->sibling = winner;
+			}
+			last = winner;
 		}
+		first->prev = nullptr;
+		return first;
 	}
 };
 
 } // namespace fontus
 
+#endif /* FONTUS_PAIRING_HEAP_H */
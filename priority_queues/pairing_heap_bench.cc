@@ -0,0 +1,107 @@
+#include "pairing_heap.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares the pairing strategies on insert-heavy workloads.
+// Usage: pairing_heap_bench [elements]
+
+typedef chrono::steady_clock Clock;
+
+template <fontus::PairingStrategy S>
+using MinHeap = fontus::PairingHeap<unsigned, less<unsigned>, S>;
+
+// n pushes of random keys, then n pops.
+template <fontus::PairingStrategy S>
+unsigned long push_then_pop(const vector<unsigned>& keys) {
+	MinHeap<S> heap;
+	unsigned long checksum = 0;
+	for (auto key: keys) {
+		heap.push(key);
+	}
+	while (!heap.empty()) {
+		checksum += heap.pop();
+	}
+	return checksum;
+}
+
+// Four pushes per pop, keys drawn above the last popped key as in an
+// event scheduler.
+template <fontus::PairingStrategy S>
+unsigned long insert_heavy_hold(const vector<unsigned>& keys) {
+	MinHeap<S> heap;
+	unsigned long checksum = 0;
+	unsigned now = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		heap.push(now + keys[i] % 1024);
+		if (i % 4 == 3) {
+			now = heap.pop();
+			checksum += now;
+		}
+	}
+	return checksum;
+}
+
+// Ascending pushes followed by pops: the sorted-input worst case.
+template <fontus::PairingStrategy S>
+unsigned long sorted_push_then_pop(const vector<unsigned>& keys) {
+	MinHeap<S> heap;
+	unsigned long checksum = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		heap.push(i);
+	}
+	while (!heap.empty()) {
+		checksum += heap.pop();
+	}
+	return checksum;
+}
+
+// Bulk construction from a range, then pops.
+template <fontus::PairingStrategy S>
+unsigned long bulk_build_then_pop(const vector<unsigned>& keys) {
+	MinHeap<S> heap(keys.begin(), keys.end());
+	unsigned long checksum = 0;
+	while (!heap.empty()) {
+		checksum += heap.pop();
+	}
+	return checksum;
+}
+
+template <typename F>
+void measure(const string& name, F workload, const vector<unsigned>& keys) {
+	auto start = Clock::now();
+	unsigned long checksum = workload(keys);
+	double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+	cout << "  " << left << setw(22) << name << right << setw(10)
+	     << fixed << setprecision(1) << ms << " ms  (" << checksum << ")\n";
+}
+
+template <fontus::PairingStrategy S>
+void run_all(const string& strategy, const vector<unsigned>& keys) {
+	cout << strategy << '\n';
+	measure("push then pop", push_then_pop<S>, keys);
+	measure("insert-heavy hold", insert_heavy_hold<S>, keys);
+	measure("sorted push then pop", sorted_push_then_pop<S>, keys);
+	measure("bulk build then pop", bulk_build_then_pop<S>, keys);
+}
+
+int main(int argc, char* argv[]) {
+	size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (1 << 20);
+
+	mt19937 rng(12345);
+	vector<unsigned> keys(n);
+	for (auto& key: keys) {
+		key = rng();
+	}
+
+	cout << n << " elements\n";
+	run_all<fontus::PairingStrategy::TWO_PASS>("two-pass", keys);
+	run_all<fontus::PairingStrategy::MULTIPASS>("multipass", keys);
+	run_all<fontus::PairingStrategy::AUXILIARY_TWO_PASS>("auxiliary two-pass",
+		keys);
+}
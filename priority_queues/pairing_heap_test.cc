@@ -1,7 +1,10 @@
 #include "pairing_heap.h"
+#include <climits>
 #include <iostream>
 #include <random>
+#include <sstream>
 #include <string>
+#include <vector>
 using namespace std;
 
 class RandomInt {
@@ -118,4 +121,74 @@ int main() {
 		cout << heeps.pop() << '\n';
 		cout << heeps.size() << '\n';
 	}
+
+	// Dijkstra with one heap entry per vertex, kept current through
+	// decrease_key instead of pushing duplicates.
+	typedef pair<int, int> DistVertex;
+	typedef fontus::PairingHeap<DistVertex, less<DistVertex>> MinHeap;
+	vector<vector<pair<int, int>>> adj = {
+		{{1, 4}, {2, 1}}, {{3, 1}}, {{1, 2}, {3, 5}}, {{4, 3}}, {}};
+	vector<int> dist(adj.size(), INT_MAX);
+	vector<MinHeap::Handle> handles(adj.size());
+	MinHeap frontier;
+	dist[0] = 0;
+	handles[0] = frontier.push({0, 0});
+
+	while (!frontier.empty()) {
+		int u = frontier.pop().second;
+		handles[u] = MinHeap::Handle();
+		for (auto& edge: adj[u]) {
+			int v = edge.first, d = dist[u] + edge.second;
+			if (d >= dist[v]) {
+				continue;
+			}
+			if (handles[v]) {
+				frontier.decrease_key(handles[v], {d, v});
+			} else {
+				handles[v] = frontier.push({d, v});
+			}
+			dist[v] = d;
+		}
+	}
+	for (size_t v = 0; v < dist.size(); ++v) {
+		cout << "dist[" << v << "] = " << dist[v] << '\n';
+	}
+
+	MinHeap h;
+	auto h5 = h.push({5, 0});
+	h.push({3, 1});
+	h.push({8, 2});
+	h.erase(h5);
+	cout << h.size() << " left, top " << h.top().first << '\n';
+
+	// Ascending pushes into a max-heap link each new root over the old
+	// one, a chain as deep as the heap. Printing, clearing and destroying
+	// it must not recurse. Keys are too long for the short string buffer,
+	// so every node owns memory.
+	const size_t depth = 300000;
+	auto key = [](size_t i) {
+		string digits = to_string(i);
+		return string(20 - digits.size(), '0') + digits;
+	};
+	size_t printed = 0;
+	{
+		fontus::PairingHeap<string> chain;
+		for (size_t i = 0; i < depth; ++i) {
+			chain.push(key(i));
+		}
+		ostringstream out;
+		chain.print(out);
+		string line;
+		for (istringstream in(out.str()); getline(in, line);) {
+			printed += line != "<<<<" && line != ">>>>";
+		}
+	}
+	fontus::PairingHeap<string> cleared;
+	for (size_t i = 0; i < depth; ++i) {
+		cleared.push(key(i));
+	}
+	cleared.clear();
+	cout << "deep chain: printed " << printed << " of " << depth
+	     << ", " << cleared.size() << " left after clear\n";
+	return printed == depth && cleared.empty() ? 0 : 1;
 }
@@ -0,0 +1,397 @@
+#include "indexed_pri_queue.h"
+#include "pairing_heap.h"
+#include <malloc.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Compares PairingHeap, IndexedPriorityQueue and std::priority_queue,
+// all as min-heaps of 64-bit keys, on a set of classic workloads.
+// Reports throughput, heap allocations per operation and the peak
+// number of bytes allocated while the workload ran.
+// Usage: pq_bench [elements...]    (default: 1000 100000 1000000)
+
+typedef chrono::steady_clock Clock;
+
+// Global allocation accounting; the benchmark is single threaded.
+static size_t allocations = 0;
+static size_t live_bytes = 0;
+static size_t peak_bytes = 0;
+
+void* operator new(size_t size) {
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr) {
+		throw bad_alloc();
+	}
+	++allocations;
+	live_bytes += malloc_usable_size(ptr);
+	peak_bytes = max(peak_bytes, live_bytes);
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	if (ptr) {
+		live_bytes -= malloc_usable_size(ptr);
+		free(ptr);
+	}
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	operator delete(ptr);
+}
+
+// Uniform push/pop/merge surface over the three heaps.
+class StdHeap {
+public:
+	static constexpr const char* NAME = "std::priority_queue";
+
+	void push(uint64_t key) {
+		heap.push(key);
+	}
+
+	uint64_t pop() {
+		uint64_t key = heap.top();
+		heap.pop();
+		return key;
+	}
+
+	bool empty() const {
+		return heap.empty();
+	}
+
+	size_t size() const {
+		return heap.size();
+	}
+
+	// No merge: the smaller heap is poured into the larger one.
+	void merge(StdHeap& that) {
+		if (size() < that.size()) {
+			swap(heap, that.heap);
+		}
+		while (!that.empty()) {
+			push(that.pop());
+		}
+	}
+
+private:
+	priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t>> heap;
+};
+
+class PairingMinHeap {
+public:
+	static constexpr const char* NAME = "PairingHeap";
+
+	void push(uint64_t key) {
+		heap.push(key);
+	}
+
+	uint64_t pop() {
+		return heap.pop();
+	}
+
+	bool empty() const {
+		return heap.empty();
+	}
+
+	void merge(PairingMinHeap& that) {
+		heap.merge(that.heap);
+	}
+
+private:
+	fontus::PairingHeap<uint64_t, less<uint64_t>> heap;
+};
+
+// The queue is addressed by key, so every push gets a fresh id.
+class IndexedHeap {
+public:
+	static constexpr const char* NAME = "IndexedPriorityQueue";
+
+	IndexedHeap() : heap(0), next_id{0} {}
+
+	void push(uint64_t key) {
+		heap.push(next_id++, key);
+	}
+
+	uint64_t pop() {
+		return heap.pop()->second;
+	}
+
+	bool empty() const {
+		return heap.empty();
+	}
+
+	size_t size() const {
+		return heap.size();
+	}
+
+	// Drains the smaller queue and pushes its entries as one batch.
+	void merge(IndexedHeap& that) {
+		if (size() < that.size()) {
+			swap(heap, that.heap);
+			swap(next_id, that.next_id);
+		}
+		vector<pair<uint64_t, uint64_t>> batch;
+		batch.reserve(that.size());
+		while (!that.empty()) {
+			batch.emplace_back(next_id++, that.pop());
+		}
+		heap.push_batch(batch.begin(), batch.end());
+	}
+
+private:
+	fontus::IndexedPriorityQueue<uint64_t, uint64_t, 4,
+		greater<uint64_t>> heap;
+	uint64_t next_id;
+};
+
+// Workloads return a checksum of the popped keys and add the number of
+// heap operations they performed to ops.
+
+// Hold model: n elements queued, then 4n rounds of popping the minimum
+// and pushing it back with a random increment.
+template <typename Heap>
+uint64_t hold(size_t n, size_t& ops) {
+	mt19937_64 rng(1);
+	Heap heap;
+	for (size_t i = 0; i < n; ++i) {
+		heap.push(rng() % (1 << 20));
+	}
+	uint64_t checksum = 0;
+	for (size_t i = 0; i < 4 * n; ++i) {
+		uint64_t key = heap.pop();
+		checksum += key;
+		heap.push(key + rng() % (1 << 20));
+	}
+	ops += n + 8 * n;
+	return checksum;
+}
+
+template <typename Heap>
+uint64_t sorted_insert(size_t n, size_t& ops) {
+	Heap heap;
+	for (size_t i = 0; i < n; ++i) {
+		heap.push(i);
+	}
+	uint64_t checksum = 0;
+	while (!heap.empty()) {
+		checksum += heap.pop();
+	}
+	ops += 2 * n;
+	return checksum;
+}
+
+template <typename Heap>
+uint64_t reverse_sorted_insert(size_t n, size_t& ops) {
+	Heap heap;
+	for (size_t i = n; i-- > 0;) {
+		heap.push(i);
+	}
+	uint64_t checksum = 0;
+	while (!heap.empty()) {
+		checksum += heap.pop();
+	}
+	ops += 2 * n;
+	return checksum;
+}
+
+// n elements in heaps of 16, merged pairwise in rounds until one heap
+// is left, which is then drained.
+template <typename Heap>
+uint64_t merge_heavy(size_t n, size_t& ops) {
+	mt19937_64 rng(2);
+	vector<Heap> heaps((n + 15) / 16);
+	for (size_t i = 0; i < n; ++i) {
+		heaps[i / 16].push(rng() % n);
+	}
+	ops += n;
+	while (heaps.size() > 1) {
+		size_t half = heaps.size() / 2;
+		for (size_t i = 0; i < half; ++i) {
+			heaps[i].merge(heaps[heaps.size() - 1 - i]);
+		}
+		ops += half;
+		heaps.resize(heaps.size() - half);
+	}
+	uint64_t checksum = 0;
+	while (!heaps[0].empty()) {
+		checksum += heaps[0].pop();
+	}
+	ops += n;
+	return checksum;
+}
+
+// Operations Dijkstra's algorithm performs on its queue. The key packs
+// the distance above the vertex, so keys are unique and every heap
+// pops the vertices in the same order.
+struct TraceOp {
+	enum Kind : uint8_t { PUSH, DECREASE, POP } kind;
+	uint32_t vertex;
+	uint64_t key;
+};
+
+// Records the trace of Dijkstra from vertex 0 on a random graph with
+// out-degree 4 and weights in [1, 1000]. The arcs are hashed from the
+// source vertex instead of stored, so large graphs fit in memory.
+vector<TraceOp> dijkstra_trace(size_t n) {
+	auto arc = [n](uint64_t u, unsigned i) {
+		uint64_t bits = fontus::mix_hash(4 * u + i + 1);
+		return make_pair(uint32_t(bits % n), 1 + (bits >> 40) % 1000);
+	};
+
+	vector<TraceOp> trace;
+	vector<uint64_t> dist(n, UINT64_MAX);
+	vector<bool> done(n, false);
+	fontus::IndexedPriorityQueue<uint32_t, uint64_t, 4,
+		greater<uint64_t>> queue(0);
+	dist[0] = 0;
+	queue.push(0, 0);
+	trace.push_back({TraceOp::PUSH, 0, 0});
+	while (auto top = queue.pop()) {
+		uint32_t u = top->first;
+		trace.push_back({TraceOp::POP, u, top->second});
+		done[u] = true;
+		for (unsigned i = 0; i < 4; ++i) {
+			auto [v, w] = arc(u, i);
+			if (done[v] || dist[u] + w >= dist[v]) {
+				continue;
+			}
+			bool queued = dist[v] != UINT64_MAX;
+			dist[v] = dist[u] + w;
+			uint64_t key = (dist[v] << 32) | v;
+			if (queued) {
+				queue.update_priority(v, key);
+				trace.push_back({TraceOp::DECREASE, v, key});
+			} else {
+				queue.push(v, key);
+				trace.push_back({TraceOp::PUSH, v, key});
+			}
+		}
+	}
+	return trace;
+}
+
+uint64_t replay(const vector<TraceOp>& trace, size_t n, size_t& ops,
+		StdHeap*) {
+	// Lazy deletion: a decrease pushes a second entry, and entries that
+	// no longer match the vertex's key are skipped when popped.
+	priority_queue<uint64_t, vector<uint64_t>, greater<uint64_t>> heap;
+	vector<uint64_t> current(n);
+	uint64_t checksum = 0;
+	for (auto& op: trace) {
+		if (op.kind == TraceOp::POP) {
+			uint64_t key;
+			do {
+				key = heap.top();
+				heap.pop();
+			} while (key != current[key & 0xffffffff]);
+			checksum += key;
+		} else {
+			current[op.vertex] = op.key;
+			heap.push(op.key);
+		}
+	}
+	ops += trace.size();
+	return checksum;
+}
+
+uint64_t replay(const vector<TraceOp>& trace, size_t n, size_t& ops,
+		PairingMinHeap*) {
+	typedef fontus::PairingHeap<uint64_t, less<uint64_t>> Heap;
+	Heap heap;
+	vector<Heap::Handle> handles(n);
+	uint64_t checksum = 0;
+	for (auto& op: trace) {
+		if (op.kind == TraceOp::PUSH) {
+			handles[op.vertex] = heap.push(op.key);
+		} else if (op.kind == TraceOp::DECREASE) {
+			heap.decrease_key(handles[op.vertex], op.key);
+		} else {
+			checksum += heap.pop();
+		}
+	}
+	ops += trace.size();
+	return checksum;
+}
+
+uint64_t replay(const vector<TraceOp>& trace, size_t n, size_t& ops,
+		IndexedHeap*) {
+	fontus::IndexedPriorityQueue<uint32_t, uint64_t, 4,
+		greater<uint64_t>> heap(0);
+	heap.reserve(n);
+	uint64_t checksum = 0;
+	for (auto& op: trace) {
+		if (op.kind == TraceOp::PUSH) {
+			heap.push(op.vertex, op.key);
+		} else if (op.kind == TraceOp::DECREASE) {
+			heap.update_priority(op.vertex, op.key);
+		} else {
+			checksum += heap.pop()->second;
+		}
+	}
+	ops += trace.size();
+	return checksum;
+}
+
+template <typename F>
+void measure(const string& name, F workload) {
+	allocations = 0;
+	size_t base_bytes = live_bytes;
+	peak_bytes = live_bytes;
+	size_t ops = 0;
+
+	auto start = Clock::now();
+	uint64_t checksum = workload(ops);
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	cout << "    " << left << setw(22) << name << right << fixed
+	     << setprecision(2) << setw(10) << ops / seconds / 1e6 << " Mops/s"
+	     << setw(8) << double(allocations) / ops << " allocs/op"
+	     << setw(10) << (peak_bytes - base_bytes) / 1048576.0 << " MiB peak"
+	     << "  (" << checksum << ")\n";
+}
+
+// Runs workload(heap tag, n, ops) against each heap.
+template <typename W>
+void compare(const string& name, size_t n, W workload) {
+	cout << "  " << name << '\n';
+	measure(StdHeap::NAME, [&](size_t& ops) {
+		return workload((StdHeap*) nullptr, n, ops); });
+	measure(PairingMinHeap::NAME, [&](size_t& ops) {
+		return workload((PairingMinHeap*) nullptr, n, ops); });
+	measure(IndexedHeap::NAME, [&](size_t& ops) {
+		return workload((IndexedHeap*) nullptr, n, ops); });
+}
+
+#define WORKLOAD(f) [](auto* tag, size_t n, size_t& ops) { \
+		return f<remove_pointer_t<decltype(tag)>>(n, ops); }
+
+int main(int argc, char* argv[]) {
+	vector<size_t> sizes;
+	for (int i = 1; i < argc; ++i) {
+		sizes.push_back(strtoull(argv[i], nullptr, 10));
+	}
+	if (sizes.empty()) {
+		sizes = {1000, 100000, 1000000};
+	}
+
+	for (size_t n: sizes) {
+		cout << n << " elements\n";
+		compare("hold model", n, WORKLOAD(hold));
+		compare("sorted insert", n, WORKLOAD(sorted_insert));
+		compare("reverse-sorted insert", n, WORKLOAD(reverse_sorted_insert));
+		compare("merge-heavy", n, WORKLOAD(merge_heavy));
+
+		auto trace = dijkstra_trace(n);
+		compare("dijkstra trace (" + to_string(trace.size()) + " ops)", n,
+			[&trace](auto* tag, size_t n, size_t& ops) {
+				return replay(trace, n, ops, tag); });
+	}
+}
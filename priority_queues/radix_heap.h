@@ -0,0 +1,293 @@
+#ifndef FONTUS_RADIX_HEAP_H
+#define FONTUS_RADIX_HEAP_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace fontus {
+
+namespace radix_heap_detail {
+
+// Bucket of key relative to the last popped key: 0 if they are equal,
+// otherwise one more than the index of the highest differing bit.
+template <typename Key>
+unsigned bucket(Key key, Key last) {
+	uint64_t diff = uint64_t(key) ^ uint64_t(last);
+	return diff ? 64 - __builtin_clzll(diff) : 0;
+}
+
+} // namespace radix_heap_detail
+
+// Monotone min-heap on unsigned integer keys (Ahuja, Mehlhorn, Orlin
+// and Tarjan). Pushed keys must not be smaller than the last popped
+// key, which holds for Dijkstra's algorithm with non-negative weights
+// and for timer queues. Entries sit in buckets by the highest bit in
+// which they differ from the last popped key; when bucket 0 runs dry
+// the lowest non-empty bucket is redistributed, and every entry moves
+// to a strictly lower bucket each time, so an entry is moved at most
+// once per key bit. No key comparisons happen between pops.
+template <typename Key, typename Value>
+class RadixHeap {
+	static_assert(std::is_unsigned<Key>::value && sizeof(Key) <= 8,
+		"RadixHeap keys are unsigned integers of at most 64 bits");
+
+public:
+	typedef std::pair<Key, Value> value_type;
+
+	RadixHeap() : buckets(BUCKETS), last{}, size_{0} {}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	// The last popped key, below which no key may be pushed.
+	Key floor() const {
+		return last;
+	}
+
+	void push(Key key, Value value) {
+		if (key < last) {
+			throw std::runtime_error("Key below the last popped key");
+		}
+		buckets[radix_heap_detail::bucket(key, last)].emplace_back(key,
+			std::move(value));
+		++size_;
+	}
+
+	// Not const: finding the minimum may redistribute a bucket.
+	const value_type& top() {
+		if (size_ == 0) {
+			throw std::runtime_error("Underflow error");
+		}
+		refill();
+		return buckets[0].back();
+	}
+
+	value_type pop() {
+		top();
+		value_type result = std::move(buckets[0].back());
+		buckets[0].pop_back();
+		--size_;
+		return result;
+	}
+
+	void clear() {
+		for (auto& bucket: buckets) {
+			bucket.clear();
+		}
+		last = Key{};
+		size_ = 0;
+	}
+
+private:
+	static constexpr unsigned BUCKETS = sizeof(Key) * CHAR_BIT + 1;
+
+	std::vector<std::vector<value_type>> buckets;
+	Key last;
+	size_t size_;
+
+	// Makes bucket 0 non-empty by moving the lowest non-empty bucket
+	// down around its minimum key.
+	void refill() {
+		if (!buckets[0].empty()) {
+			return;
+		}
+
+		unsigned index = 1;
+		while (buckets[index].empty()) {
+			++index;
+		}
+		auto& source = buckets[index];
+		Key min_key = source[0].first;
+		for (auto& entry: source) {
+			min_key = std::min(min_key, entry.first);
+		}
+		last = min_key;
+		for (auto& entry: source) {
+			buckets[radix_heap_detail::bucket(entry.first, last)].push_back(
+				std::move(entry));
+		}
+		source.clear();
+	}
+};
+
+// Radix heap over dense ids 0..capacity-1 with decrease_key, for
+// shortest paths without duplicate entries. Every queued id records
+// its bucket and its slot in it, so an id can be moved to a lower
+// bucket, or removed, in O(1).
+template <typename Key>
+class IndexedRadixHeap {
+	static_assert(std::is_unsigned<Key>::value && sizeof(Key) <= 8,
+		"RadixHeap keys are unsigned integers of at most 64 bits");
+
+public:
+	typedef std::pair<size_t, Key> value_type;
+
+	explicit IndexedRadixHeap(size_t capacity) : buckets(BUCKETS),
+		keys(capacity), bucket_of(capacity, NOT_QUEUED), slot_of(capacity),
+		last{}, size_{0} {}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	size_t size() const {
+		return size_;
+	}
+
+	Key floor() const {
+		return last;
+	}
+
+	bool contains(size_t id) const {
+		return bucket_of[id] != NOT_QUEUED;
+	}
+
+	// Key of a queued id.
+	Key key(size_t id) const {
+		return keys[id];
+	}
+
+	// Returns false if the id is already queued.
+	bool push(size_t id, Key key) {
+		if (contains(id)) {
+			return false;
+		}
+		if (key < last) {
+			throw std::runtime_error("Key below the last popped key");
+		}
+		keys[id] = key;
+		insert(id);
+		++size_;
+		return true;
+	}
+
+	// Lowers the key of a queued id. Returns false if the id is not
+	// queued; throws if key is above its current key or below the last
+	// popped key.
+	bool decrease_key(size_t id, Key key) {
+		if (!contains(id)) {
+			return false;
+		}
+		if (key > keys[id]) {
+			throw std::runtime_error("New key is further from the top");
+		}
+		if (key < last) {
+			throw std::runtime_error("Key below the last popped key");
+		}
+		keys[id] = key;
+		unsigned bucket = radix_heap_detail::bucket(key, last);
+		if (bucket != bucket_of[id]) {
+			unlink(id);
+			insert(id);
+		}
+		return true;
+	}
+
+	// Pushes the id, or lowers its key if that makes it smaller: the
+	// relaxation step of Dijkstra's algorithm. Returns true if the key
+	// of the id changed.
+	bool push_or_decrease(size_t id, Key key) {
+		if (!contains(id)) {
+			return push(id, key);
+		}
+		if (key >= keys[id]) {
+			return false;
+		}
+		return decrease_key(id, key);
+	}
+
+	// Not const: finding the minimum may redistribute a bucket.
+	value_type top() {
+		if (size_ == 0) {
+			throw std::runtime_error("Underflow error");
+		}
+		refill();
+		size_t id = buckets[0].back();
+		return value_type(id, keys[id]);
+	}
+
+	value_type pop() {
+		value_type result = top();
+		unlink(result.first);
+		--size_;
+		return result;
+	}
+
+	bool erase(size_t id) {
+		if (!contains(id)) {
+			return false;
+		}
+		unlink(id);
+		--size_;
+		return true;
+	}
+
+private:
+	static constexpr unsigned BUCKETS = sizeof(Key) * CHAR_BIT + 1;
+	static constexpr uint8_t NOT_QUEUED = std::numeric_limits<uint8_t>::max();
+
+	std::vector<std::vector<size_t>> buckets;
+	std::vector<Key> keys;
+	std::vector<uint8_t> bucket_of;
+	std::vector<size_t> slot_of;
+	Key last;
+	size_t size_;
+
+	void insert(size_t id) {
+		unsigned bucket = radix_heap_detail::bucket(keys[id], last);
+		bucket_of[id] = bucket;
+		slot_of[id] = buckets[bucket].size();
+		buckets[bucket].push_back(id);
+	}
+
+	// Removes id from its bucket by moving the bucket's last id into
+	// its slot.
+	void unlink(size_t id) {
+		auto& bucket = buckets[bucket_of[id]];
+		size_t moved = bucket.back();
+		bucket[slot_of[id]] = moved;
+		slot_of[moved] = slot_of[id];
+		bucket.pop_back();
+		bucket_of[id] = NOT_QUEUED;
+	}
+
+	void refill() {
+		if (!buckets[0].empty()) {
+			return;
+		}
+
+		unsigned index = 1;
+		while (buckets[index].empty()) {
+			++index;
+		}
+		std::vector<size_t> source;
+		source.swap(buckets[index]);
+		Key min_key = keys[source[0]];
+		for (size_t id: source) {
+			min_key = std::min(min_key, keys[id]);
+		}
+		last = min_key;
+		for (size_t id: source) {
+			insert(id);
+		}
+		// Every id moved to a lower bucket: hand the storage back so
+		// the bucket does not reallocate when it fills up again.
+		source.clear();
+		buckets[index].swap(source);
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_RADIX_HEAP_H */
@@ -0,0 +1,153 @@
+#include "radix_heap.h"
+#include "pairing_heap.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Dijkstra on a random graph with integer weights, once per heap.
+// Usage: radix_heap_ex1 [vertices]
+
+typedef chrono::steady_clock Clock;
+typedef pair<uint32_t, uint32_t> Arc;	// (target, weight)
+const uint64_t INF = numeric_limits<uint64_t>::max();
+
+vector<vector<Arc>> random_graph(size_t n, size_t degree) {
+	mt19937 rng(2024);
+	vector<vector<Arc>> graph(n);
+	for (size_t u = 0; u < n; ++u) {
+		for (size_t i = 0; i < degree; ++i) {
+			graph[u].emplace_back(rng() % n, 1 + rng() % 100000);
+		}
+	}
+	return graph;
+}
+
+// Lazy deletion: a vertex may be queued several times and stale
+// entries are skipped when popped.
+vector<uint64_t> dijkstra_radix(const vector<vector<Arc>>& graph) {
+	vector<uint64_t> dist(graph.size(), INF);
+	fontus::RadixHeap<uint64_t, uint32_t> heap;
+	dist[0] = 0;
+	heap.push(0, 0);
+	while (!heap.empty()) {
+		auto [d, u] = heap.pop();
+		if (d != dist[u]) {
+			continue;
+		}
+		for (auto [v, w]: graph[u]) {
+			if (d + w < dist[v]) {
+				dist[v] = d + w;
+				heap.push(dist[v], v);
+			}
+		}
+	}
+	return dist;
+}
+
+vector<uint64_t> dijkstra_indexed_radix(const vector<vector<Arc>>& graph) {
+	vector<uint64_t> dist(graph.size(), INF);
+	fontus::IndexedRadixHeap<uint64_t> heap(graph.size());
+	dist[0] = 0;
+	heap.push(0, 0);
+	while (!heap.empty()) {
+		auto [u, d] = heap.pop();
+		for (auto [v, w]: graph[u]) {
+			if (d + w < dist[v]) {
+				dist[v] = d + w;
+				heap.push_or_decrease(v, dist[v]);
+			}
+		}
+	}
+	return dist;
+}
+
+vector<uint64_t> dijkstra_pairing(const vector<vector<Arc>>& graph) {
+	// PairingHeap pops a before b if Cmp(a, b): less<> is a min-heap.
+	fontus::PairingHeap<pair<uint64_t, uint32_t>,
+		less<pair<uint64_t, uint32_t>>> heap;
+	vector<uint64_t> dist(graph.size(), INF);
+	dist[0] = 0;
+	heap.push({0, 0});
+	while (!heap.empty()) {
+		auto [d, u] = heap.pop();
+		if (d != dist[u]) {
+			continue;
+		}
+		for (auto [v, w]: graph[u]) {
+			if (d + w < dist[v]) {
+				dist[v] = d + w;
+				heap.push({dist[v], v});
+			}
+		}
+	}
+	return dist;
+}
+
+vector<uint64_t> dijkstra_std(const vector<vector<Arc>>& graph) {
+	priority_queue<pair<uint64_t, uint32_t>, vector<pair<uint64_t, uint32_t>>,
+		greater<pair<uint64_t, uint32_t>>> heap;
+	vector<uint64_t> dist(graph.size(), INF);
+	dist[0] = 0;
+	heap.push({0, 0});
+	while (!heap.empty()) {
+		auto [d, u] = heap.top();
+		heap.pop();
+		if (d != dist[u]) {
+			continue;
+		}
+		for (auto [v, w]: graph[u]) {
+			if (d + w < dist[v]) {
+				dist[v] = d + w;
+				heap.push({dist[v], v});
+			}
+		}
+	}
+	return dist;
+}
+
+template <typename F>
+vector<uint64_t> measure(const string& name, F dijkstra,
+		const vector<vector<Arc>>& graph) {
+	auto start = Clock::now();
+	vector<uint64_t> dist = dijkstra(graph);
+	double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+	cout << "  " << left << setw(22) << name << right << setw(10)
+	     << fixed << setprecision(1) << ms << " ms\n";
+	return dist;
+}
+
+int main(int argc, char* argv[]) {
+	size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (1 << 18);
+
+	// A timer queue: deadlines only ever move forward.
+	fontus::RadixHeap<uint32_t, string> timers;
+	timers.push(250, "retransmit");
+	timers.push(100, "heartbeat");
+	timers.push(100, "flush");
+	timers.push(4000, "lease expiry");
+	while (!timers.empty()) {
+		auto [at, name] = timers.pop();
+		cout << at << ": " << name << '\n';
+		if (name == "heartbeat") {
+			timers.push(at + 1000, "heartbeat again");
+		}
+	}
+
+	auto graph = random_graph(n, 8);
+	cout << "\nDijkstra, " << n << " vertices, " << 8 * n << " arcs\n";
+	auto expected = measure("std::priority_queue", dijkstra_std, graph);
+	bool same = measure("PairingHeap", dijkstra_pairing, graph) == expected;
+	same &= measure("RadixHeap", dijkstra_radix, graph) == expected;
+	same &= measure("IndexedRadixHeap", dijkstra_indexed_radix,
+		graph) == expected;
+	cout << (same ? "All distances agree\n" : "Distances differ!\n");
+	return same ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+#ifndef FONTUS_TOP_K_H
+#define FONTUS_TOP_K_H
+
+#include "indexed_pri_queue.h"
+#include "common/flat_hash_map.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace fontus {
+
+// Approximate count of every key in a stream, in a fixed amount of
+// memory. Each key maps to one counter per row and its estimate is the
+// smallest of them, which never undercounts. Conservative update only
+// raises the counters that are at that minimum, which keeps the
+// overcount from colliding keys low.
+template <typename Key, typename Hash = FlatHash<Key>>
+class CountMinSketch {
+public:
+	// width is rounded up to a power of two.
+	CountMinSketch(size_t width, unsigned depth) : mask{1}, depth{depth} {
+		while (mask < width) {
+			mask *= 2;
+		}
+		counters.assign(mask * depth, 0);
+		--mask;
+	}
+
+	// Adds count occurrences of key and returns its new estimate.
+	template <typename K>
+	uint64_t add(const K& key, uint64_t count = 1) {
+		size_t h1 = Hash()(key);
+		size_t h2 = mix_hash(h1) | 1;
+		uint64_t estimate = UINT64_MAX;
+		for (unsigned row = 0; row < depth; ++row) {
+			estimate = std::min(estimate, counters[index(row, h1, h2)]);
+		}
+		estimate += count;
+		for (unsigned row = 0; row < depth; ++row) {
+			uint64_t& counter = counters[index(row, h1, h2)];
+			counter = std::max(counter, estimate);
+		}
+		return estimate;
+	}
+
+	template <typename K>
+	uint64_t estimate(const K& key) const {
+		size_t h1 = Hash()(key);
+		size_t h2 = mix_hash(h1) | 1;
+		uint64_t estimate = UINT64_MAX;
+		for (unsigned row = 0; row < depth; ++row) {
+			estimate = std::min(estimate, counters[index(row, h1, h2)]);
+		}
+		return estimate;
+	}
+
+	void clear() {
+		std::fill(counters.begin(), counters.end(), 0);
+	}
+
+private:
+	std::vector<uint64_t> counters;
+	size_t mask;
+	unsigned depth;
+
+	// Double hashing gives each row its own, independent enough, slot.
+	size_t index(unsigned row, size_t h1, size_t h2) const {
+		return row * (mask + 1) + ((h1 + row * h2) & mask);
+	}
+};
+
+// Tracks the k most frequent keys of a stream (heavy hitters) in O(k)
+// memory. Every event updates a Count-Min sketch; only keys whose
+// estimate beats the smallest tracked count reach the min-queue of
+// tracked keys, which evicts its minimum when it overflows. The
+// smallest tracked count is cached, so an event for a key that is not
+// hot costs a sketch update and no hash map probe. Counts are sketch
+// estimates and may exceed the true counts.
+template <typename Key, typename Hash = FlatHash<Key>>
+class TopK {
+public:
+	// width is the number of sketch counters per row. The default of
+	// 64 per tracked key keeps the overcount of keys just below the top
+	// k small enough that they rarely push out true heavy hitters.
+	explicit TopK(size_t k, size_t width = 0, unsigned depth = 4)
+		: sketch(width ? width : 64 * k, depth),
+		  tracked(k), k{k}, threshold{0} {
+		assert(k > 0);
+	}
+
+	size_t capacity() const {
+		return k;
+	}
+
+	size_t size() const {
+		return tracked.size();
+	}
+
+	// Records count occurrences of key. The key is only copied into a
+	// Key if it enters the tracked set.
+	template <typename K>
+	void add(const K& key, uint64_t count = 1) {
+		uint64_t estimate = sketch.add(key, count);
+		if (tracked.size() == k && estimate <= threshold) {
+			// A tracked key was last seen at an estimate of at least
+			// threshold, so this one must be new and is not hot enough.
+			return;
+		}
+
+		if (!tracked.update_priority(key, estimate)) {
+			if (tracked.size() == k) {
+				tracked.pop();
+			}
+			tracked.push(Key(key), estimate);
+		}
+		threshold = tracked.size() == k ? *tracked.top_priority() : 0;
+	}
+
+	template <typename K>
+	uint64_t estimate(const K& key) const {
+		return sketch.estimate(key);
+	}
+
+	template <typename K>
+	bool contains(const K& key) const {
+		return tracked.contains(key);
+	}
+
+	// The tracked keys with their counts, most frequent first.
+	std::vector<std::pair<Key, uint64_t>> top() const {
+		auto queue = tracked;
+		std::vector<std::pair<Key, uint64_t>> result;
+		result.reserve(queue.size());
+		while (auto entry = queue.pop()) {
+			result.push_back(std::move(*entry));
+		}
+		std::reverse(result.begin(), result.end());
+		return result;
+	}
+
+	void clear() {
+		sketch.clear();
+		tracked = Queue(k);
+		threshold = 0;
+	}
+
+private:
+	typedef IndexedPriorityQueue<Key, uint64_t, 4, std::greater<uint64_t>,
+		Hash> Queue;
+
+	CountMinSketch<Key, Hash> sketch;
+	Queue tracked;
+	size_t k;
+	uint64_t threshold;
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_TOP_K_H */
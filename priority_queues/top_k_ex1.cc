@@ -0,0 +1,87 @@
+#include "top_k.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Finds the hottest keys of a Zipf distributed stream and checks them
+// against exact counts.
+// Usage: top_k_ex1 [events] [distinct keys] [k]
+
+typedef chrono::steady_clock Clock;
+
+// Keys 0..n-1 drawn with probability proportional to 1 / (rank + 1).
+vector<uint64_t> zipf_stream(size_t events, size_t n) {
+	vector<double> cdf(n);
+	double total = 0;
+	for (size_t i = 0; i < n; ++i) {
+		total += 1.0 / (i + 1);
+		cdf[i] = total;
+	}
+	mt19937_64 rng(7);
+	uniform_real_distribution<double> uniform(0, total);
+	// Scatter the ranks so that hot keys are not simply the small ids.
+	vector<uint64_t> stream(events);
+	for (auto& key: stream) {
+		size_t rank = lower_bound(cdf.begin(), cdf.end(), uniform(rng)) -
+			cdf.begin();
+		key = fontus::mix_hash(rank);
+	}
+	return stream;
+}
+
+int main(int argc, char* argv[]) {
+	size_t events = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000000;
+	size_t n = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 1000000;
+	size_t k = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 100;
+
+	// Requests by path; lookups take string_views into the log lines.
+	fontus::TopK<string> paths(2);
+	string log = "/index /login /index /api /index /api /img /api /index";
+	for (size_t start = 0; start < log.size();) {
+		size_t end = min(log.find(' ', start), log.size());
+		paths.add(string_view(log).substr(start, end - start));
+		start = end + 1;
+	}
+	for (auto& [path, count]: paths.top()) {
+		cout << path << ' ' << count << '\n';
+	}
+
+	auto stream = zipf_stream(events, n);
+	fontus::TopK<uint64_t> top(k);
+	auto start = Clock::now();
+	for (auto key: stream) {
+		top.add(key);
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	unordered_map<uint64_t, uint64_t> exact;
+	for (auto key: stream) {
+		++exact[key];
+	}
+	vector<pair<uint64_t, uint64_t>> expected(exact.begin(), exact.end());
+	partial_sort(expected.begin(), expected.begin() + min(k, expected.size()),
+		expected.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+	size_t found = 0;
+	double error = 0;
+	for (size_t i = 0; i < min(k, expected.size()); ++i) {
+		found += top.contains(expected[i].first);
+		error += double(top.estimate(expected[i].first)) /
+			expected[i].second - 1;
+	}
+	cout << "\n" << events << " events over " << exact.size()
+	     << " keys, k = " << k << '\n'
+	     << fixed << setprecision(1) << "  " << events / seconds / 1e6
+	     << " M events/s\n"
+	     << "  " << found << " of the true top " << k << " tracked\n"
+	     << setprecision(3) << "  mean overcount of their estimates "
+	     << 100 * error / k << "%\n";
+}
@@ -0,0 +1,113 @@
+#ifndef FONTUS_FENWICK_TREE_H
+#define FONTUS_FENWICK_TREE_H
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include "monoid.h"
+#include "segment_tree.h"
+
+namespace fontus {
+
+// Binary indexed tree over a group: one value per element, half of
+// what SegmentTree keeps. Node i holds the fold of the elements in
+// (i - lowbit(i), i] (1-based), so a prefix is the fold of at most
+// log n nodes, and a range the difference of two prefixes.
+template <typename T, typename Iter, typename Group = Sum<T>>
+class FenwickTree {
+	static_assert(is_group<Group>::value,
+		"FenwickTree needs an invertible operation");
+
+public:
+	// Builds in O(n): each node, once complete, is folded into its
+	// parent, the next node whose range covers it.
+	FenwickTree(Iter start, Iter end, Group combine = Group())
+		: tree(start, end), combine(std::move(combine)) {
+		for (size_t i = 1; i <= tree.size(); ++i) {
+			size_t parent = i + (i & -i);
+			if (parent <= tree.size()) {
+				tree[parent - 1] = this->combine(std::move(tree[parent - 1]),
+					tree[i - 1]);
+			}
+		}
+	}
+
+	// Fold of the first k elements.
+	T prefix(size_t k) const {
+		assert(k <= tree.size());
+		T result = Group::identity();
+		for (; k > 0; k -= k & -k) {
+			result = combine(std::move(result), tree[k - 1]);
+		}
+		return result;
+	}
+
+	// Fold of the elements in [left, right].
+	T query(size_t left, size_t right) const {
+		assert(left <= right && right < tree.size());
+		return combine(prefix(right + 1), Group::inverse(prefix(left)));
+	}
+
+	// Combines delta into the element at index.
+	void add(size_t index, const T& delta) {
+		assert(index < tree.size());
+		for (size_t i = index + 1; i <= tree.size(); i += i & -i) {
+			tree[i - 1] = combine(std::move(tree[i - 1]), delta);
+		}
+	}
+
+	void update(const T& val, size_t index) {
+		add(index, combine(val, Group::inverse(query(index, index))));
+	}
+
+	T operator[](size_t index) const {
+		return query(index, index);
+	}
+
+	// Search by weight: the smallest k such that the first k + 1
+	// elements fold to at least value, or length() if there is none.
+	// The elements must not be negative.
+	size_t lower_bound(T value) const {
+		size_t step = 1;
+		while (2 * step <= tree.size()) {
+			step *= 2;
+		}
+		size_t k = 0;
+		for (; step > 0; step /= 2) {
+			if (k + step <= tree.size() && tree[k + step - 1] < value) {
+				k += step;
+				value = combine(std::move(value),
+					Group::inverse(tree[k - 1]));
+			}
+		}
+		return k;
+	}
+
+	size_t length() const {
+		return tree.size();
+	}
+
+	void print() const {
+		for (size_t i = 0; i < tree.size(); ++i) {
+			std::cout << i + 1 << ": " << tree[i] << '\n';
+		}
+	}
+
+private:
+	std::vector<T> tree;
+	Group combine;
+};
+
+// The cheapest tree for a monoid: a FenwickTree when it is a group,
+// otherwise a SegmentTree. Both take (start, end) and share query,
+// update, operator[] and length.
+template <typename T, typename Iter, typename Monoid = Sum<T>>
+using RangeTree = std::conditional_t<is_group<Monoid>::value,
+	FenwickTree<T, Iter, Monoid>, SegmentTree<T, Iter, Monoid>>;
+
+} // namespace fontus
+
+#endif /* FONTUS_FENWICK_TREE_H */
@@ -0,0 +1,35 @@
+#include <vector>
+#include "fenwick_tree.h"
+using namespace std;
+
+// Sums over a RangeTree, which is a FenwickTree for Sum and a
+// SegmentTree for any other monoid.
+template <typename Tree>
+void report(const char* name, Tree& tree) {
+	cout << name << "[0, 9] = " << tree.query(0, 9) << '\n';
+	cout << name << "[3, 5] = " << tree.query(3, 5) << '\n';
+	tree.update(-4, 4);
+	cout << name << "[3, 5] = " << tree.query(3, 5) << " after update\n";
+}
+
+int main() {
+	int arr[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+	fontus::FenwickTree<int, int*> counts(&arr[0], &arr[10]);
+	counts.print();
+	counts.add(2, 10);
+	cout << "prefix(3) = " << counts.prefix(3) << '\n';
+	cout << "counts[2] = " << counts[2] << '\n';
+
+	// Weighted sampling: the element whose cumulative weight reaches a
+	// given point.
+	for (int weight: {1, 2, 16, 17, 65, 66}) {
+		cout << "weight " << weight << " falls in element "
+		     << counts.lower_bound(weight) << '\n';
+	}
+
+	fontus::RangeTree<int, int*> sums(&arr[0], &arr[10]);
+	report("sum", sums);
+	fontus::RangeTree<int, int*, fontus::Max<int>> maxes(&arr[0], &arr[10]);
+	report("max", maxes);
+}
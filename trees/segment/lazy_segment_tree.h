@@ -0,0 +1,255 @@
+#ifndef FONTUS_LAZY_SEGMENT_TREE_H
+#define FONTUS_LAZY_SEGMENT_TREE_H
+
+#include <cassert>
+#include <iostream>
+#include <optional>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include "monoid.h"
+
+namespace fontus {
+
+// A value combined with itself count times: what a node spanning count
+// elements holds if they all equal value.
+template <typename Monoid>
+struct Repeat;
+
+template <typename T>
+struct Repeat<Sum<T>> {
+	static T apply(const T& value, size_t count) {
+		return value * T(count);
+	}
+};
+
+template <typename T>
+struct Repeat<Min<T>> {
+	static T apply(const T& value, size_t) {
+		return value;
+	}
+};
+
+template <typename T>
+struct Repeat<Max<T>> {
+	static T apply(const T& value, size_t) {
+		return value;
+	}
+};
+
+// Range update actions. An action has a type for its pending updates,
+// the identity update, apply(f, x, count) to update a node folding
+// count elements to x, and compose(f, g) for f applied after g.
+
+// Adds a constant to every element.
+template <typename T, typename Monoid>
+struct RangeAdd {
+	typedef T type;
+
+	static type identity() {
+		return T{};
+	}
+
+	static T apply(const type& f, const T& x, size_t count) {
+		return x + Repeat<Monoid>::apply(f, count);
+	}
+
+	static type compose(const type& f, const type& g) {
+		return f + g;
+	}
+};
+
+// Sets every element to a value.
+template <typename T, typename Monoid>
+struct RangeAssign {
+	typedef std::optional<T> type;
+
+	static type identity() {
+		return std::nullopt;
+	}
+
+	static T apply(const type& f, const T& x, size_t count) {
+		return f ? Repeat<Monoid>::apply(*f, count) : x;
+	}
+
+	static type compose(const type& f, const type& g) {
+		return f ? f : g;
+	}
+};
+
+// Maps every element x to scale * x + shift. With Min or Max the scale
+// must not be negative, or the order of the elements would flip.
+template <typename T, typename Monoid>
+struct Affine {
+	struct type {
+		T scale;
+		T shift;
+	};
+
+	static type identity() {
+		return {T(1), T{}};
+	}
+
+	static T apply(const type& f, const T& x, size_t count) {
+		return f.scale * x + Repeat<Monoid>::apply(f.shift, count);
+	}
+
+	static type compose(const type& f, const type& g) {
+		return {f.scale * g.scale, f.scale * g.shift + f.shift};
+	}
+};
+
+// Segment tree with range updates and range queries, both O(log n).
+// An update of a whole node is recorded at the node and only pushed
+// down to its children when a later operation needs to look inside.
+// Same bottom-up layout as SegmentTree, with the leaves padded to a
+// power of two so every node spans a power-of-two range.
+template <typename T, typename Iter, typename Monoid = Sum<T>,
+	typename Action = RangeAdd<T, Monoid>>
+class LazySegmentTree {
+public:
+	typedef typename Action::type action_type;
+
+	LazySegmentTree(Iter start, Iter end, Monoid combine = Monoid())
+		: size(end - start), levels(0), combine(std::move(combine)) {
+		while ((size_t(1) << levels) < size) {
+			++levels;
+		}
+		leaves = size_t(1) << levels;
+		tree.assign(2*leaves, Monoid::identity());
+		pending.assign(leaves, Action::identity());
+		std::copy(start, end, tree.begin() + leaves);
+		for (size_t i = leaves; i-- > 1;) {
+			pull(i);
+		}
+	}
+
+	// Folds the elements in [left, right], in order.
+	T query(size_t left, size_t right) {
+		assert(left <= right && right < size);
+		left += leaves;
+		right += leaves + 1;
+		push_boundaries(left, right);
+
+		T result_left = Monoid::identity();
+		T result_right = Monoid::identity();
+		for (; left < right; left /= 2, right /= 2) {
+			if (left & 1) {
+				result_left = combine(std::move(result_left), tree[left++]);
+			}
+			if (right & 1) {
+				result_right = combine(tree[--right], result_right);
+			}
+		}
+		return combine(std::move(result_left), result_right);
+	}
+
+	// Applies f to every element in [left, right].
+	void apply(size_t left, size_t right, const action_type& f) {
+		assert(left <= right && right < size);
+		left += leaves;
+		right += leaves + 1;
+		push_boundaries(left, right);
+
+		for (size_t l = left, r = right; l < r; l /= 2, r /= 2) {
+			if (l & 1) {
+				apply_node(l++, f);
+			}
+			if (r & 1) {
+				apply_node(--r, f);
+			}
+		}
+
+		for (unsigned level = 1; level <= levels; ++level) {
+			if (((left >> level) << level) != left) {
+				pull(left >> level);
+			}
+			if (((right >> level) << level) != right) {
+				pull((right - 1) >> level);
+			}
+		}
+	}
+
+	void update(const T& val, size_t index) {
+		assert(index < size);
+		set_leaf(index, val);
+	}
+
+	void update(T&& val, size_t index) {
+		assert(index < size);
+		set_leaf(index, std::move(val));
+	}
+
+	size_t length() const {
+		return size;
+	}
+
+	// Prints the elements, not the padding leaves, with every pending
+	// action applied.
+	void print() {
+		for (size_t i = 0; i < size; ++i) {
+			std::cout << i << ": " << query(i, i) << '\n';
+		}
+	}
+
+private:
+	size_t size;
+	unsigned levels;
+	size_t leaves;
+	std::vector<T> tree;
+	// Updates not yet applied to the children of each inner node.
+	std::vector<action_type> pending;
+	Monoid combine;
+
+	// Number of elements under node i.
+	size_t span(size_t i) const {
+		return leaves >> (63 - __builtin_clzll(i));
+	}
+
+	void pull(size_t i) {
+		tree[i] = combine(tree[2*i], tree[2*i + 1]);
+	}
+
+	void apply_node(size_t i, const action_type& f) {
+		tree[i] = Action::apply(f, tree[i], span(i));
+		if (i < leaves) {
+			pending[i] = Action::compose(f, pending[i]);
+		}
+	}
+
+	void push(size_t i) {
+		apply_node(2*i, pending[i]);
+		apply_node(2*i + 1, pending[i]);
+		pending[i] = Action::identity();
+	}
+
+	// Pushes pending updates down the paths to the leaves at either
+	// end of [left, right), top first, so that every node the loop
+	// then touches is current.
+	void push_boundaries(size_t left, size_t right) {
+		for (unsigned level = levels; level >= 1; --level) {
+			if (((left >> level) << level) != left) {
+				push(left >> level);
+			}
+			if (((right >> level) << level) != right) {
+				push((right - 1) >> level);
+			}
+		}
+	}
+
+	template <typename V>
+	void set_leaf(size_t index, V&& val) {
+		size_t i = leaves + index;
+		for (unsigned level = levels; level >= 1; --level) {
+			push(i >> level);
+		}
+		tree[i] = std::forward<V>(val);
+		for (unsigned level = 1; level <= levels; ++level) {
+			pull(i >> level);
+		}
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_LAZY_SEGMENT_TREE_H */
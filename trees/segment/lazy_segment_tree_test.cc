@@ -0,0 +1,38 @@
+#include <vector>
+#include "lazy_segment_tree.h"
+using namespace std;
+
+int main() {
+	typedef vector<long>::iterator Iter;
+	vector<long> buckets = {5, 3, 8, 6, 1, 4, 7, 2, 9, 0};
+
+	// Bulk adjustments to ranges of time buckets.
+	fontus::LazySegmentTree<long, Iter> totals(buckets.begin(), buckets.end());
+	totals.apply(2, 7, 10);
+	totals.apply(0, 4, -1);
+	cout << "sum[0, 9] = " << totals.query(0, 9) << '\n';
+	cout << "sum[3, 5] = " << totals.query(3, 5) << '\n';
+	totals.update(100, 4);
+	cout << "sum[4, 4] = " << totals.query(4, 4) << '\n';
+
+	fontus::LazySegmentTree<long, Iter, fontus::Min<long>> lows(
+		buckets.begin(), buckets.end());
+	lows.apply(0, 4, 5);
+	cout << "min[0, 5] = " << lows.query(0, 5) << '\n';
+
+	typedef fontus::RangeAssign<long, fontus::Max<long>> Assign;
+	fontus::LazySegmentTree<long, Iter, fontus::Max<long>, Assign> highs(
+		buckets.begin(), buckets.end());
+	highs.apply(6, 9, 3);
+	cout << "max[5, 9] = " << highs.query(5, 9) << '\n';
+	highs.print();
+
+	// Rescale buckets 0..4 by 2 and shift them by 1.
+	typedef fontus::Affine<long, fontus::Sum<long>> Rescale;
+	fontus::LazySegmentTree<long, Iter, fontus::Sum<long>, Rescale> scaled(
+		buckets.begin(), buckets.end());
+	scaled.apply(0, 4, {2, 1});
+	scaled.apply(3, 9, {1, -1});
+	cout << "sum[0, 9] = " << scaled.query(0, 9) << '\n';
+	cout << "sum[0, 2] = " << scaled.query(0, 2) << '\n';
+}
@@ -0,0 +1,359 @@
+#ifndef FONTUS_MAPPED_SEGMENT_TREE_H
+#define FONTUS_MAPPED_SEGMENT_TREE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "monoid.h"
+
+namespace fontus {
+
+// Header in the first page of a MappedSegmentTree file. complete is
+// cleared while the tree is being built or has unsynced updates, so a
+// file left behind by an interrupted build or update is not mistaken
+// for a consistent one.
+struct MappedSegmentTreeHeader {
+	static constexpr uint64_t MAGIC = 0x54474553534e4f46ull;  // "FONSSEGT"
+
+	uint64_t magic;
+	uint64_t element_size;
+	uint64_t length;
+	uint64_t page_bytes;
+	uint64_t complete;
+};
+
+// SegmentTree kept in a memory-mapped file, for arrays larger than
+// memory. The tree is a perfect binary tree over the elements padded to
+// a power of two, cut into subtrees of h levels that each fill one page,
+// with h as large as a page allows. A path from the root to a leaf then
+// crosses O(log n / h) = O(log_B n) pages. Cuts are counted from the
+// leaves, so only the root's page is partly empty, and pages that only
+// cover padding are never written and stay holes in the file.
+//
+// Reopening the file maps the finished tree again without a rebuild,
+// read-only if the file cannot be written. The elements must be
+// trivially copyable, and are stored as their bytes; a file is only
+// portable between builds that agree on T.
+template <typename T, typename Monoid = Sum<T>>
+class MappedSegmentTree {
+	static_assert(std::is_trivially_copyable<T>::value,
+		"MappedSegmentTree stores elements as raw bytes");
+
+public:
+	// Builds a tree over [start, end) into the file at path, replacing
+	// it. Pages are filled in one forward pass over the elements, and
+	// each page's subtree is folded as soon as its leaves, or the pages
+	// below it, are done, so every page is written about once while it
+	// is resident. page_bytes defaults to the host's page size.
+	template <typename Iter>
+	MappedSegmentTree(const std::string& path, Iter start, Iter end,
+			Monoid combine = Monoid(), uint64_t page_bytes = 0)
+		: path(path), writable(true), dirty(true),
+			combine(std::move(combine)) {
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0) {
+			throw std::runtime_error("cannot create segment tree file " + path);
+		}
+		size = std::distance(start, end);
+		layout(std::max<uint64_t>(page_bytes ? page_bytes : default_page_bytes(),
+			sizeof(MappedSegmentTreeHeader)));
+		map(true);
+
+		header() = MappedSegmentTreeHeader{MappedSegmentTreeHeader::MAGIC,
+			sizeof(T), size, this->page_bytes, 0};
+		if (size > 0) {
+			build_page(1, top_levels, start);
+		}
+		sync();
+	}
+
+	// Opens a tree built earlier. The page size is the one it was built
+	// with, which need not be this machine's.
+	explicit MappedSegmentTree(const std::string& path,
+			Monoid combine = Monoid())
+		: path(path), writable(true), dirty(false),
+			combine(std::move(combine)) {
+		fd = ::open(path.c_str(), O_RDWR);
+		if (fd < 0 && (errno == EACCES || errno == EROFS)) {
+			writable = false;
+			fd = ::open(path.c_str(), O_RDONLY);
+		}
+		if (fd < 0) {
+			throw std::runtime_error("cannot open segment tree file " + path);
+		}
+		MappedSegmentTreeHeader header;
+		bool ok = ::pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+			header.magic == MappedSegmentTreeHeader::MAGIC &&
+			header.element_size == sizeof(T) && header.complete &&
+			header.page_bytes >= sizeof(header);
+		if (!ok) {
+			::close(fd);
+			throw std::runtime_error("not a segment tree file: " + path);
+		}
+		size = header.length;
+		layout(header.page_bytes);
+		struct stat status;
+		if (::fstat(fd, &status) != 0 || uint64_t(status.st_size) < file_bytes) {
+			::close(fd);
+			throw std::runtime_error("truncated segment tree file " + path);
+		}
+		map(false);
+	}
+
+	MappedSegmentTree(const MappedSegmentTree&) = delete;
+	MappedSegmentTree& operator=(const MappedSegmentTree&) = delete;
+
+	~MappedSegmentTree() {
+		if (dirty) {
+			try {
+				sync();
+			} catch (...) {
+			}
+		}
+		::munmap(base, file_bytes);
+		::close(fd);
+	}
+
+	// Folds the elements in [left, right], in order.
+	T query(uint64_t left, uint64_t right) const {
+		assert(left <= right && right < size);
+
+		T result_left = Monoid::identity();
+		T result_right = Monoid::identity();
+		for (left += leaves, right += leaves + 1; left < right;
+				left /= 2, right /= 2) {
+			if (left & 1) {
+				result_left = combine(std::move(result_left), load(left++));
+			}
+			if (right & 1) {
+				result_right = combine(load(--right), result_right);
+			}
+		}
+		return combine(std::move(result_left), result_right);
+	}
+
+	// Changes the file in place. Until the next sync() the file is marked
+	// incomplete, so that one left by a crash mid-update is not reopened.
+	void update(const T& val, uint64_t index) {
+		assert(index < size);
+		if (!writable) {
+			throw std::runtime_error("segment tree file is read-only: " + path);
+		}
+		if (!dirty) {
+			header().complete = 0;
+			sync_bytes(page_bytes);
+			dirty = true;
+		}
+		uint64_t k = leaves + index;
+		store(k, val);
+		for (k /= 2; k > 0; k /= 2) {
+			refold(k);
+		}
+	}
+
+	T operator[](uint64_t index) const {
+		assert(index < size);
+		return load(leaves + index);
+	}
+
+	uint64_t length() const {
+		return size;
+	}
+
+	bool read_only() const {
+		return !writable;
+	}
+
+	// Writes changes back to the file, then marks it complete again. The
+	// destructor does this too.
+	void sync() {
+		if (!dirty) {
+			return;
+		}
+		sync_bytes(file_bytes);
+		header().complete = 1;
+		sync_bytes(page_bytes);
+		dirty = false;
+	}
+
+	void print() const {
+		for (uint64_t i = 0; i < size; ++i) {
+			std::cout << i << ": " << load(leaves + i) << '\n';
+		}
+	}
+
+private:
+	std::string path;
+	bool writable;
+	// Changed since the last sync, and so marked incomplete.
+	bool dirty;
+	int fd;
+	char* base;
+	size_t file_bytes;
+	uint64_t size;
+	// Nodes are numbered as a heap: the root is 1, the children of k
+	// are 2k and 2k + 1, and the leaves start at leaves.
+	uint64_t leaves;
+	unsigned height;
+	uint64_t page_bytes;
+	// Levels per full page, and in the root's page.
+	unsigned page_levels;
+	unsigned top_levels;
+	// First page of each band of page_levels levels, after the root's.
+	uint64_t band_offsets[64];
+	Monoid combine;
+
+	static uint64_t default_page_bytes() {
+		return ::sysconf(_SC_PAGESIZE);
+	}
+
+	static unsigned level(uint64_t k) {
+		return 63 - __builtin_clzll(k);
+	}
+
+	MappedSegmentTreeHeader& header() {
+		return *reinterpret_cast<MappedSegmentTreeHeader*>(base);
+	}
+
+	void layout(uint64_t requested_page_bytes) {
+		height = 0;
+		while ((uint64_t(1) << height) < size) {
+			++height;
+		}
+		leaves = uint64_t(1) << height;
+
+		page_bytes = requested_page_bytes;
+		while (page_bytes < sizeof(T)) {
+			page_bytes += requested_page_bytes;
+		}
+		page_levels = 1;
+		while (((uint64_t(2) << page_levels) - 1) * sizeof(T) <= page_bytes) {
+			++page_levels;
+		}
+		top_levels = (height + 1) % page_levels;
+		if (top_levels == 0) {
+			top_levels = page_levels;
+		}
+
+		uint64_t pages = 1;
+		unsigned bands = (height + 1 - top_levels) / page_levels;
+		for (unsigned band = 0; band < bands; ++band) {
+			band_offsets[band] = pages;
+			pages += uint64_t(1) << (top_levels + band * page_levels);
+		}
+		file_bytes = (1 + pages) * page_bytes;
+	}
+
+	void sync_bytes(size_t bytes) {
+		if (::msync(base, bytes, MS_SYNC) != 0) {
+			throw std::runtime_error("cannot sync segment tree file " + path);
+		}
+	}
+
+	void map(bool create) {
+		if (create && ::ftruncate(fd, file_bytes) != 0) {
+			::close(fd);
+			throw std::runtime_error("cannot size segment tree file " + path);
+		}
+		int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+		void* mapped = ::mmap(nullptr, file_bytes, protection, MAP_SHARED, fd,
+			0);
+		if (mapped == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error("cannot map segment tree file " + path);
+		}
+		base = static_cast<char*>(mapped);
+	}
+
+	// Address of node k: the page of the subtree it falls in, after the
+	// header page, then its heap position within that subtree.
+	char* address(uint64_t k) const {
+		unsigned depth = level(k);
+		uint64_t page = 0;
+		if (depth >= top_levels) {
+			unsigned band = (depth - top_levels) / page_levels;
+			unsigned root_depth = top_levels + band * page_levels;
+			unsigned local_depth = depth - root_depth;
+			page = band_offsets[band] +
+				((k >> local_depth) - (uint64_t(1) << root_depth));
+			depth = local_depth;
+		}
+		uint64_t local = (uint64_t(1) << depth) |
+			(k & ((uint64_t(1) << depth) - 1));
+		return base + (1 + page) * page_bytes + (local - 1) * sizeof(T);
+	}
+
+	T load(uint64_t k) const {
+		T value;
+		std::memcpy(&value, address(k), sizeof(T));
+		return value;
+	}
+
+	void store(uint64_t k, const T& value) {
+		std::memcpy(address(k), &value, sizeof(T));
+	}
+
+	// Index of the first element under node k.
+	uint64_t first_leaf(uint64_t k) const {
+		return (k << (height - level(k))) - leaves;
+	}
+
+	// Fills and folds the page whose subtree of levels levels is rooted
+	// at node k, reading its elements from start. The pages below it are
+	// built first, left to right, and each node on its bottom level is
+	// folded as soon as the two pages under it are done.
+	template <typename Iter>
+	void build_page(uint64_t k, unsigned levels, Iter& start) {
+		uint64_t bottom = k << (levels - 1);
+		uint64_t width = uint64_t(1) << (levels - 1);
+		if (level(bottom) == height) {
+			for (uint64_t b = bottom; b < bottom + width && b - leaves < size;
+					++b, ++start) {
+				store(b, *start);
+			}
+		} else {
+			for (uint64_t b = bottom; b < bottom + width && first_leaf(b) < size;
+					++b) {
+				build_page(2*b, page_levels, start);
+				if (first_leaf(2*b + 1) < size) {
+					build_page(2*b + 1, page_levels, start);
+				}
+				refold(b);
+			}
+		}
+
+		for (unsigned depth = levels - 1; depth-- > 0;) {
+			uint64_t first = k << depth;
+			for (uint64_t i = first; i < first + (uint64_t(1) << depth) &&
+					first_leaf(i) < size; ++i) {
+				refold(i);
+			}
+		}
+	}
+
+	// Recomputes internal node k from its children, leaving out a right
+	// child that only covers padding.
+	void refold(uint64_t k) {
+		if (first_leaf(2*k + 1) < size) {
+			store(k, combine(load(2*k), load(2*k + 1)));
+		} else {
+			store(k, load(2*k));
+		}
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_MAPPED_SEGMENT_TREE_H */
@@ -0,0 +1,135 @@
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_segment_tree.h"
+using namespace std;
+
+// Builds a file-backed tree, changes it, and reopens it as a later run
+// would, without rebuilding, checking every step against the array.
+// The file is a temporary one unless named.
+// Usage: mapped_segment_tree_test [file]
+
+// Number of random ranges and elements on which tree disagrees with
+// values.
+template <typename Tree>
+size_t mismatches(const Tree& tree, const vector<long>& values) {
+	mt19937 rng(1);
+	size_t wrong = tree.length() != values.size();
+	for (int i = 0; i < 2000 && !wrong; ++i) {
+		size_t left = rng() % values.size();
+		size_t right = left + rng() % min<size_t>(values.size() - left, 5000);
+		long sum = 0;
+		for (size_t j = left; j <= right; ++j) {
+			sum += values[j];
+		}
+		wrong += tree.query(left, right) != sum;
+		wrong += tree[left] != values[left];
+	}
+	return wrong;
+}
+
+int run(const string& path) {
+	vector<long> values(1000000);
+	for (size_t i = 0; i < values.size(); ++i) {
+		values[i] = i % 100;
+	}
+
+	{
+		fontus::MappedSegmentTree<long> sums(path, values.begin(),
+			values.end());
+		cout << "sum[0, 999999] = " << sums.query(0, 999999) << '\n';
+		cout << "sum[10, 19] = " << sums.query(10, 19) << '\n';
+		sums.update(1000, 15);
+		values[15] = 1000;
+
+		// Until synced, the file is marked as not consistent.
+		try {
+			fontus::MappedSegmentTree<long> unsynced(path);
+			cout << "opened a file with unsynced updates\n";
+			return 1;
+		} catch (const std::runtime_error&) {
+			cout << "rejected while updates are unsynced\n";
+		}
+		sums.sync();
+	}
+
+	{
+		fontus::MappedSegmentTree<long> reopened(path);
+		cout << "reopened " << reopened.length() << " elements\n";
+		cout << "sum[10, 19] = " << reopened.query(10, 19) << '\n';
+		if (mismatches(reopened, values) > 0) {
+			cout << "reopened tree differs from the array\n";
+			return 1;
+		}
+	}
+
+	try {
+		fontus::MappedSegmentTree<int> wrong(path);
+		cout << "opened as a tree of int\n";
+		return 1;
+	} catch (const std::runtime_error&) {
+		cout << "rejected as a tree of int\n";
+	}
+
+	// Pages larger than the host's, as on a machine with 16K pages.
+	{
+		fontus::MappedSegmentTree<long> large_pages(path, values.begin(),
+			values.end(), fontus::Sum<long>(), 4 * sysconf(_SC_PAGESIZE));
+	}
+	{
+		fontus::MappedSegmentTree<long> reopened(path);
+		if (mismatches(reopened, values) > 0) {
+			cout << "tree with large pages differs from the array\n";
+			return 1;
+		}
+		cout << "reopened a tree built with 4x pages\n";
+	}
+
+	// A file that cannot be written is mapped read-only. Root can write
+	// it anyway, so there the check is skipped.
+	chmod(path.c_str(), 0444);
+	if (access(path.c_str(), W_OK) == 0) {
+		cout << "read-only reopen skipped: file still writable\n";
+		return 0;
+	}
+	fontus::MappedSegmentTree<long> read_only(path);
+	if (!read_only.read_only() || mismatches(read_only, values) > 0) {
+		cout << "read-only reopen failed\n";
+		return 1;
+	}
+	try {
+		read_only.update(0, 0);
+		cout << "updated a read-only tree\n";
+		return 1;
+	} catch (const std::runtime_error&) {
+		cout << "read-only tree rejected an update\n";
+	}
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	string path;
+	if (argc > 1) {
+		path = argv[1];
+	} else {
+		char name[] = "/tmp/mapped_segment_tree_testXXXXXX";
+		int fd = mkstemp(name);
+		if (fd < 0) {
+			cout << "cannot create a temporary file\n";
+			return 1;
+		}
+		close(fd);
+		path = name;
+	}
+
+	int status = run(path);
+	if (argc <= 1) {
+		unlink(path.c_str());
+	} else {
+		chmod(path.c_str(), 0644);
+	}
+	return status;
+}
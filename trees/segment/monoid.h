@@ -0,0 +1,70 @@
+#ifndef FONTUS_MONOID_H
+#define FONTUS_MONOID_H
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace fontus {
+
+// Monoids a segment tree folds with: an associative combine, called as
+// a function object, and its identity element. Combine need not be
+// commutative; trees always pass the left operand first.
+
+// Addition, or concatenation for strings and other types whose +
+// appends. The rvalue overload appends to the left operand in place.
+template <typename T>
+struct Sum {
+	static T identity() {
+		return T{};
+	}
+
+	T operator()(const T& a, const T& b) const {
+		return a + b;
+	}
+
+	T operator()(T&& a, const T& b) const {
+		a += b;
+		return std::move(a);
+	}
+
+	// Only for types with a negation.
+	static T inverse(const T& a) {
+		return -a;
+	}
+};
+
+template <typename T>
+struct Min {
+	static T identity() {
+		return std::numeric_limits<T>::max();
+	}
+
+	T operator()(const T& a, const T& b) const {
+		return std::min(a, b);
+	}
+};
+
+template <typename T>
+struct Max {
+	static T identity() {
+		return std::numeric_limits<T>::lowest();
+	}
+
+	T operator()(const T& a, const T& b) const {
+		return std::max(a, b);
+	}
+};
+
+// Whether a monoid is a group: it has inverse(a), so a range can be
+// folded as the difference of two prefixes.
+template <typename Monoid>
+struct is_group : std::false_type {};
+
+template <typename T>
+struct is_group<Sum<T>> : std::is_arithmetic<T> {};
+
+} // namespace fontus
+
+#endif /* FONTUS_MONOID_H */
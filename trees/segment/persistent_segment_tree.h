@@ -0,0 +1,219 @@
+#ifndef FONTUS_PERSISTENT_SEGMENT_TREE_H
+#define FONTUS_PERSISTENT_SEGMENT_TREE_H
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include "monoid.h"
+
+namespace fontus {
+
+// Segment tree that keeps every version of the array. Nodes live in one
+// arena and are never modified once built: an update copies the O(log n)
+// nodes on the path to its leaf and shares the rest with the version it
+// started from, then returns the id of the new version. Version 0 is the
+// array the tree was built from.
+//
+// Released versions keep their nodes until collect(), which copies the
+// nodes still reachable from a live version into a new arena.
+template <typename T, typename Iter, typename Monoid = Sum<T>>
+class PersistentSegmentTree {
+public:
+	PersistentSegmentTree(Iter start, Iter end, Monoid combine = Monoid())
+		: size(end - start), combine(std::move(combine)) {
+		if (size > 0) {
+			nodes.reserve(2*size - 1);
+			roots.push_back(build(start, 0, size));
+		} else {
+			roots.push_back(NONE);
+		}
+	}
+
+	// Sets the element at index in the latest version.
+	size_t update(const T& val, size_t index) {
+		return update(val, index, latest());
+	}
+
+	// Sets the element at index in the given version, which need not be
+	// the latest, and returns the id of the resulting version.
+	size_t update(const T& val, size_t index, size_t version) {
+		assert(index < size && live(version));
+		uint32_t root = set(roots[version], 0, size, index, val);
+		roots.push_back(root);
+		return roots.size() - 1;
+	}
+
+	// Folds the elements in [left, right] as of version.
+	T query(size_t version, size_t left, size_t right) const {
+		assert(left <= right && right < size && live(version));
+		return fold(roots[version], 0, size, left, right + 1);
+	}
+
+	const T& at(size_t version, size_t index) const {
+		assert(index < size && live(version));
+		uint32_t node = roots[version];
+		for (size_t lo = 0, hi = size; hi - lo > 1;) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (index < mid) {
+				node = nodes[node].left;
+				hi = mid;
+			} else {
+				node = nodes[node].right;
+				lo = mid;
+			}
+		}
+		return nodes[node].value;
+	}
+
+	size_t latest() const {
+		return roots.size() - 1;
+	}
+
+	bool live(size_t version) const {
+		return version < roots.size() && roots[version] != NONE;
+	}
+
+	// Drops a version. Its nodes are reclaimed by the next collect()
+	// unless a live version shares them. Ids of other versions stay valid.
+	void release(size_t version) {
+		assert(live(version));
+		roots[version] = NONE;
+	}
+
+	// Drops every version older than version.
+	void release_before(size_t version) {
+		assert(version < roots.size());
+		for (size_t i = 0; i < version; ++i) {
+			roots[i] = NONE;
+		}
+	}
+
+	// Compacts the arena down to the nodes of the live versions. The nodes
+	// of each version are copied depth first, so a version's tree ends up
+	// mostly contiguous. Returns the number of nodes freed.
+	size_t collect() {
+		std::vector<uint32_t> moved(nodes.size(), NONE);
+		std::vector<Node> kept;
+		for (uint32_t& root: roots) {
+			if (root != NONE) {
+				root = relocate(root, moved, kept);
+			}
+		}
+		size_t freed = nodes.size() - kept.size();
+		nodes.swap(kept);
+		return freed;
+	}
+
+	size_t length() const {
+		return size;
+	}
+
+	// Nodes in the arena, shared ones counted once.
+	size_t node_count() const {
+		return nodes.size();
+	}
+
+	void print(size_t version) const {
+		for (size_t i = 0; i < size; ++i) {
+			std::cout << i << ": " << at(version, i) << '\n';
+		}
+	}
+
+private:
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	// Children are only meaningful in internal nodes; a node covering a
+	// single element is a leaf.
+	struct Node {
+		T value;
+		uint32_t left;
+		uint32_t right;
+	};
+
+	size_t size;
+	std::vector<Node> nodes;
+	std::vector<uint32_t> roots;
+	Monoid combine;
+
+	uint32_t allocate(Node node) {
+		if (nodes.size() >= NONE) {
+			throw std::runtime_error("PersistentSegmentTree arena is full");
+		}
+		nodes.push_back(std::move(node));
+		return nodes.size() - 1;
+	}
+
+	// Builds the subtree over [lo, hi) from the elements at start + lo.
+	uint32_t build(Iter start, size_t lo, size_t hi) {
+		if (hi - lo == 1) {
+			return allocate(Node{*(start + lo), NONE, NONE});
+		}
+		size_t mid = lo + (hi - lo) / 2;
+		uint32_t left = build(start, lo, mid);
+		uint32_t right = build(start, mid, hi);
+		return allocate(Node{combine(nodes[left].value, nodes[right].value),
+			left, right});
+	}
+
+	// Copy of node, over [lo, hi), with the element at index set to val.
+	uint32_t set(uint32_t node, size_t lo, size_t hi, size_t index,
+			const T& val) {
+		if (hi - lo == 1) {
+			return allocate(Node{val, NONE, NONE});
+		}
+		size_t mid = lo + (hi - lo) / 2;
+		uint32_t left = nodes[node].left;
+		uint32_t right = nodes[node].right;
+		if (index < mid) {
+			left = set(left, lo, mid, index, val);
+		} else {
+			right = set(right, mid, hi, index, val);
+		}
+		return allocate(Node{combine(nodes[left].value, nodes[right].value),
+			left, right});
+	}
+
+	// Fold of the elements in [left, right) under node, over [lo, hi).
+	T fold(uint32_t node, size_t lo, size_t hi, size_t left,
+			size_t right) const {
+		if (left <= lo && hi <= right) {
+			return nodes[node].value;
+		}
+		size_t mid = lo + (hi - lo) / 2;
+		if (right <= mid) {
+			return fold(nodes[node].left, lo, mid, left, right);
+		}
+		if (left >= mid) {
+			return fold(nodes[node].right, mid, hi, left, right);
+		}
+		return combine(fold(nodes[node].left, lo, mid, left, right),
+			fold(nodes[node].right, mid, hi, left, right));
+	}
+
+	// Index in kept of the copy of node, copying its subtree on the first
+	// visit. Leaves have no children to follow.
+	uint32_t relocate(uint32_t node, std::vector<uint32_t>& moved,
+			std::vector<Node>& kept) {
+		if (moved[node] != NONE) {
+			return moved[node];
+		}
+		uint32_t copy = kept.size();
+		moved[node] = copy;
+		kept.push_back(std::move(nodes[node]));
+		if (kept[copy].left != NONE) {
+			uint32_t left = relocate(kept[copy].left, moved, kept);
+			uint32_t right = relocate(kept[copy].right, moved, kept);
+			kept[copy].left = left;
+			kept[copy].right = right;
+		}
+		return copy;
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_PERSISTENT_SEGMENT_TREE_H */
@@ -0,0 +1,32 @@
+#include <vector>
+#include "persistent_segment_tree.h"
+using namespace std;
+
+int main() {
+	int arr[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+	fontus::PersistentSegmentTree<int, int*> sums(&arr[0], &arr[10]);
+	size_t first = sums.update(100, 4);
+	size_t second = sums.update(-3, 0);
+	// Branch off the original array rather than the latest version.
+	size_t branch = sums.update(0, 9, 0);
+
+	for (size_t version: {size_t(0), first, second, branch}) {
+		cout << "version " << version << ": sum[0, 9] = "
+		     << sums.query(version, 0, 9) << ", sum[3, 5] = "
+		     << sums.query(version, 3, 5) << '\n';
+	}
+	cout << "nodes: " << sums.node_count() << '\n';
+
+	sums.release_before(second);
+	sums.release(branch);
+	cout << "freed " << sums.collect() << " nodes, " << sums.node_count()
+	     << " left\n";
+	sums.print(second);
+
+	fontus::PersistentSegmentTree<int, int*, fontus::Max<int>> maxes(&arr[0],
+		&arr[10]);
+	size_t lowered = maxes.update(0, 9);
+	cout << "max[0, 9] = " << maxes.query(0, 0, 9) << " then "
+	     << maxes.query(lowered, 0, 9) << '\n';
+}
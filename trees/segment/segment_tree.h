@@ -1,137 +1,217 @@
 #ifndef FONTUS_SEGMENT_TREE_H
 #define FONTUS_SEGMENT_TREE_H
 
+#include <cassert>
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <stdexcept>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include "monoid.h"
+#include "common/default_init_allocator.h"
 
-int fold_right(int x) {
-	auto max = 8 * sizeof(x);
-	int prevx = 0;
+namespace fontus {
 
-	for (int i = 1; i < max && x != prevx; i *= 2) {
-		prevx = x;
-		x |= (x >> i);
+// Folds any range of elements with a monoid in O(log n). The tree is
+// stored bottom-up in one array of 2n values: leaves at [n, 2n) and
+// node i combining nodes 2i and 2i+1. Queries and updates walk it with
+// a loop, and the monoid is a template parameter so that combining
+// inlines into them.
+template <typename T, typename Iter, typename Monoid = Sum<T>>
+class SegmentTree {
+public:
+	// Large arrays are built by several threads, 0 meaning one per
+	// hardware thread. The tree is allocated without being initialized,
+	// so its pages are first touched by the threads that fill them: the
+	// leaves are copied in one band per thread, then each level is folded
+	// in bands, level by level. Threads are not pinned, and each level
+	// starts new ones, so a band is not necessarily built on the node that
+	// holds the band below it.
+	SegmentTree(Iter start, Iter end, Monoid combine = Monoid(),
+			unsigned threads = 0)
+		: size(end - start), tree(std::max<size_t>(2*size, 1)),
+			combine(std::move(combine)) {
+		// Unused by the tree, but must hold a value for copies to read.
+		tree[0] = Monoid::identity();
+		threads = worker_count(threads, size, MIN_BUILD_PER_THREAD);
+		for_slices(size, threads, [&](size_t from, size_t to) {
+			std::copy(start + from, start + to, tree.begin() + size + from);
+		});
+
+		// Nodes [ceil(hi / 2), hi) only have children in [hi, 2hi), which
+		// are leaves or nodes of the levels already built.
+		for (size_t hi = size; hi > 1;) {
+			size_t lo = (hi + 1) / 2;
+			threads = worker_count(threads, hi - lo, MIN_BUILD_PER_THREAD);
+			for_slices(hi - lo, threads, [&, lo](size_t from, size_t to) {
+				for (size_t i = lo + from; i < lo + to; ++i) {
+					tree[i] = this->combine(tree[2*i], tree[2*i + 1]);
+				}
+			});
+			hi = lo;
+		}
 	}
 
-	return x;
-}
-
-int next_power_2(int x) {
-	return fold_right(x) + 1;
-}
-
-int last_power_2(int x) {
-	return fold_right(x >> 1) + 1;
-}
-
-namespace fontus {
+	// Folds the elements in [left, right], in order.
+	T query(size_t left, size_t right) const {
+		assert(left <= right && right < size);
+
+		T result_left = Monoid::identity();
+		T result_right = Monoid::identity();
+		for (left += size, right += size + 1; left < right;
+				left /= 2, right /= 2) {
+			if (left & 1) {
+				result_left = combine(std::move(result_left), tree[left++]);
+			}
+			if (right & 1) {
+				result_right = combine(tree[--right], result_right);
+			}
+		}
+		return combine(std::move(result_left), result_right);
+	}
 
-template <typename T>
-struct Segment {
-	T value;
-	int min;
-	int max;
+	// Answers a batch of [left, right] pairs, returning the results in
+	// input order. The queries are bucketed by left end, so that
+	// neighbouring queries share the lower levels of their paths, and
+	// while one query is walked the bottom of the paths of a later one
+	// is prefetched, which overlaps its cache misses with the work.
+	// Large batches are split across threads; 0 means one per hardware
+	// thread.
+	template <typename RangeIter>
+	std::vector<T> query_batch(RangeIter first, RangeIter last,
+			unsigned threads = 0) const {
+		std::vector<BatchQuery> batch = sort_batch(first, last);
+		std::vector<T> results(batch.size());
+		for_slices(batch.size(),
+			worker_count(threads, batch.size(), MIN_BATCH_PER_THREAD),
+			[&](size_t begin, size_t end) {
+				query_sorted(batch, begin, end, results);
+			});
+		return results;
+	}
 
-	Segment(T value) : value(value) {}
-	Segment(T value, int min, int max) : value(value), min(min), max(max) {}
-};
+	void update(const T& val, size_t index) {
+		assert(index < size);
+		tree[size + index] = val;
+		update_ancestors(size + index);
+	}
 
-template <typename T, typename Iter>
-class SegmentTree {
-public:
-	SegmentTree(Iter start, Iter end, std::function<T(T,T)> func, T identity = T{})
-		: identity(std::move(identity)), size(end - start), nelems(0), func(func) {
-		if (size > 0) {
-			nelems = next_power_2(size);
-		}
-		tree.reserve(2*nelems - 1);
-		tree.resize(2*nelems - 1, Segment<T>{this->identity});
-		populate(start, end);
+	void update(T&& val, size_t index) {
+		assert(index < size);
+		tree[size + index] = std::move(val);
+		update_ancestors(size + index);
 	}
 
-	T query(int left, int right) {
-		return query(0, left, right);
+	const T& operator[](size_t index) const {
+		return tree[size + index];
 	}
 
-	void update(const T& val, int index) {
-		return update(0, val, index);
+	size_t length() const {
+		return size;
 	}
 
-	void print() {
-		for (auto& e: tree) {
-			std::cout << e.value << '[' << e.min << ','
-				  << e.max << ']' << '\n';
+	void print() const {
+		for (size_t i = 1; i < tree.size(); ++i) {
+			std::cout << i << ": " << tree[i] << '\n';
 		}
 	}
 
 private:
-	const T identity;
-	std::vector<Segment<T>> tree;
-	int size;
-	int nelems;
-	std::function<T(T,T)> func;
-
-	void populate(Iter start, Iter end) {
-		int i = nelems - 1;
-		for (Iter it = start; it != end; ++it) {
-			tree[i] = Segment<T>{*it, int(it - start),
-				int(it - start)};
-			++i;
+	static constexpr size_t PREFETCH_DISTANCE = 8;
+	static constexpr unsigned PREFETCH_LEVELS = 4;
+	static constexpr size_t MIN_BATCH_PER_THREAD = 1 << 14;
+	static constexpr size_t MIN_BUILD_PER_THREAD = 1 << 16;
+
+	size_t size;
+	std::vector<T, DefaultInitAllocator<T>> tree;
+	Monoid combine;
+
+	// Requested threads, 0 meaning all, capped so that each gets at
+	// least min_work of the work.
+	static unsigned worker_count(unsigned threads, size_t work,
+			size_t min_work) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
 		}
+		return std::min<size_t>(threads, (work + min_work - 1) / min_work);
+	}
 
-		int index = end - start;
-		while (i < tree.size()) {
-			tree[i++] = Segment<T>{this->identity, index, index};
-			++index;
+	// Calls func(begin, end) on consecutive slices of [0, count), one
+	// per thread.
+	template <typename Func>
+	static void for_slices(size_t count, unsigned threads, Func func) {
+		if (threads <= 1) {
+			func(0, count);
+			return;
 		}
 
-		for (int i = nelems - 2; i >= 0; --i) {
-			tree[i].value = func(tree[2*i + 1].value,
-				tree[2*i + 2].value);
-			tree[i].min = tree[2*i + 1].min;
-			tree[i].max = tree[2*i + 2].max;
+		std::vector<std::thread> workers;
+		size_t chunk = (count + threads - 1) / threads;
+		for (size_t begin = 0; begin < count; begin += chunk) {
+			workers.emplace_back(func, begin, std::min(begin + chunk, count));
+		}
+		for (auto& worker: workers) {
+			worker.join();
 		}
 	}
 
-	T query(int base, int left, int right) {
-		auto min = tree[base].min, max = tree[base].max;
-
-		if (left < min || right > max) {
-			throw std::runtime_error("Out of range");
+	struct BatchQuery {
+		size_t left;
+		size_t right;
+		size_t index;
+	};
+
+	// Counting sort of the queries into about one bucket per four
+	// queries by the high bits of their left end.
+	template <typename RangeIter>
+	std::vector<BatchQuery> sort_batch(RangeIter first, RangeIter last) const {
+		size_t count = std::distance(first, last);
+		unsigned bucket_bits = 0;
+		while (bucket_bits < 16 && (size_t(4) << bucket_bits) < count) {
+			++bucket_bits;
 		}
-
-		if (left == right && min == left && max == right) {
-			return tree[base].value;
+		unsigned size_bits = 0;
+		while ((size_t(1) << size_bits) < size) {
+			++size_bits;
 		}
+		unsigned shift = size_bits > bucket_bits ? size_bits - bucket_bits : 0;
 
-		int mid = min + (max - min) / 2;
-		if (right <= mid) {
-			return query(2*base + 1, left, right);
-		} else if (left > mid) {
-			return query(2*base + 2, left, right);
-		} else {
-			return func(query(2*base + 1, left, mid),
-				query(2*base + 2, mid+1, right));
+		std::vector<size_t> starts((size_t(1) << bucket_bits) + 1);
+		for (RangeIter it = first; it != last; ++it) {
+			++starts[(size_t(it->first) >> shift) + 1];
 		}
-	}
-
-	void update(int base, const T& val, int index) {
-		if (base < 0 || base >= tree.size()) {
-			throw std::runtime_error("Update base out of range");
+		std::partial_sum(starts.begin(), starts.end(), starts.begin());
+
+		std::vector<BatchQuery> batch(count);
+		size_t index = 0;
+		for (RangeIter it = first; it != last; ++it, ++index) {
+			assert(it->first <= it->second && size_t(it->second) < size);
+			batch[starts[size_t(it->first) >> shift]++] =
+				BatchQuery{size_t(it->first), size_t(it->second), index};
 		}
+		return batch;
+	}
 
-		if (index < 0 || index >= size) {
-			throw std::runtime_error("Update index out of range");
+	// Answers batch[begin, end) into results.
+	void query_sorted(const std::vector<BatchQuery>& batch, size_t begin,
+			size_t end, std::vector<T>& results) const {
+		for (size_t i = begin; i < end; ++i) {
+			if (i + PREFETCH_DISTANCE < end) {
+				size_t left = batch[i + PREFETCH_DISTANCE].left + size;
+				size_t right = batch[i + PREFETCH_DISTANCE].right + size;
+				for (unsigned level = 0; level < PREFETCH_LEVELS; ++level) {
+					__builtin_prefetch(&tree[left >> level]);
+					__builtin_prefetch(&tree[right >> level]);
+				}
+			}
+			results[batch[i].index] = query(batch[i].left, batch[i].right);
 		}
+	}
 
-		int i = nelems - 1 + index;
-		tree[i].value = val;
-		while (i > 0) {
-			i = i / 2;
-			tree[i].value = func(tree[2*i + 1].value,
-						tree[2*i + 2].value);
+	void update_ancestors(size_t i) {
+		for (i /= 2; i > 0; i /= 2) {
+			tree[i] = combine(tree[2*i], tree[2*i + 1]);
 		}
 	}
 };
@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <random>
 #include <string>
+#include <utility>
+#include <vector>
 #include "segment_tree.h"
 using namespace std;
 
@@ -6,18 +10,71 @@ int main() {
 	string arr[10] = {"Australia", "England", "West Indies", "England",
 	"England", "Australia", "Pakistan", "India", "Sri Lanka", "Sri Lanka"};
 
-	fontus::SegmentTree<string, string*> stree(&arr[0], &arr[10],
-		[] (string a, string b) ->string {
-			return a + b;
-		});
+	// Sum concatenates strings, so a query spells out the range.
+	fontus::SegmentTree<string, string*> stree(&arr[0], &arr[10]);
 	stree.print();
+	cout << stree.query(2, 4) << '\n';
 
 	int arr1[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
 
-	fontus::SegmentTree<int, int*> stree1(&arr1[0], &arr1[10],
-		[] (int a, int b) ->int {
-			return a + b;
-		});
+	fontus::SegmentTree<int, int*> stree1(&arr1[0], &arr1[10]);
 	stree1.print();
 	stree1.update(10, 4);
+	cout << "sum[0, 9] = " << stree1.query(0, 9) << '\n';
+	cout << "sum[3, 5] = " << stree1.query(3, 5) << '\n';
+
+	vector<pair<int, int>> ranges = {{7, 9}, {0, 0}, {2, 6}, {0, 9}, {5, 5}};
+	auto sums = stree1.query_batch(ranges.begin(), ranges.end());
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		cout << "sum[" << ranges[i].first << ", " << ranges[i].second
+		     << "] = " << sums[i] << '\n';
+	}
+
+	fontus::SegmentTree<int, int*, fontus::Min<int>> mins(&arr1[0],
+		&arr1[10]);
+	mins.update(-1, 7);
+	cout << "min[0, 6] = " << mins.query(0, 6) << '\n';
+	cout << "min[5, 9] = " << mins.query(5, 9) << '\n';
+
+	fontus::SegmentTree<int, int*, fontus::Max<int>> maxes(&arr1[0],
+		&arr1[10]);
+	cout << "max[2, 2] = " << maxes.query(2, 2) << '\n';
+	cout << "max[0, 8] = " << maxes.query(0, 8) << '\n';
+
+	// Large arrays are built by several threads. The trees must match a
+	// sequential build, also for concatenation, which does not commute.
+	mt19937 rng(1);
+	vector<string> letters(1 << 19);
+	for (auto& letter: letters) {
+		letter = string(1, 'a' + rng() % 26);
+	}
+	vector<int> numbers(1 << 20);
+	for (auto& number: numbers) {
+		number = rng();
+	}
+	typedef vector<string>::iterator StringIter;
+	typedef vector<int>::iterator IntIter;
+	fontus::SegmentTree<string, StringIter> words(letters.begin(),
+		letters.end(), fontus::Sum<string>(), 1);
+	fontus::SegmentTree<string, StringIter> parallel_words(letters.begin(),
+		letters.end(), fontus::Sum<string>(), 4);
+	fontus::SegmentTree<int, IntIter, fontus::Min<int>> lows(numbers.begin(),
+		numbers.end(), fontus::Min<int>(), 1);
+	fontus::SegmentTree<int, IntIter, fontus::Min<int>> parallel_lows(
+		numbers.begin(), numbers.end(), fontus::Min<int>(), 4);
+
+	size_t mismatches = words.query(0, letters.size() - 1) !=
+		parallel_words.query(0, letters.size() - 1);
+	for (int i = 0; i < 4000; ++i) {
+		size_t left = rng() % letters.size();
+		size_t right = left + rng() % min<size_t>(letters.size() - left, 300);
+		mismatches += words.query(left, right) !=
+			parallel_words.query(left, right);
+		left = rng() % numbers.size();
+		right = left + rng() % (numbers.size() - left);
+		mismatches += lows.query(left, right) !=
+			parallel_lows.query(left, right);
+	}
+	cout << "parallel builds: " << mismatches << " mismatches\n";
+	return mismatches > 0;
 }
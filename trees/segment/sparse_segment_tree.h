@@ -0,0 +1,180 @@
+#ifndef FONTUS_SPARSE_SEGMENT_TREE_H
+#define FONTUS_SPARSE_SEGMENT_TREE_H
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include "monoid.h"
+
+namespace fontus {
+
+// Segment tree over the coordinates [0, 2^bits), bits up to 64, of which
+// only a few are ever set. Every other element is the monoid's
+// identity. The tree is a binary trie on the bits of the coordinate,
+// and only nodes on the paths to set elements exist, so memory grows
+// with the number of distinct coordinates set, at most bits + 1 nodes
+// each, and not with the domain.
+//
+// Nodes come from a pool, one vector addressed by 32-bit indices, which
+// keeps them small and contiguous; node 0 is the root.
+template <typename T, typename Monoid = Sum<T>>
+class SparseSegmentTree {
+public:
+	explicit SparseSegmentTree(unsigned bits = 64, Monoid combine = Monoid())
+		: bits(bits), combine(std::move(combine)) {
+		assert(bits > 0 && bits <= 64);
+		allocate();
+	}
+
+	// Folds the elements in [left, right].
+	T query(uint64_t left, uint64_t right) const {
+		assert(left <= right && right <= last_coordinate());
+		return fold(0, bits, 0, left, right);
+	}
+
+	void update(const T& val, uint64_t index) {
+		modify(index, [&](T& element) {
+			element = val;
+		});
+	}
+
+	// Combines delta into the element at index, e.g. counts an event.
+	void add(uint64_t index, const T& delta) {
+		modify(index, [&](T& element) {
+			element = combine(std::move(element), delta);
+		});
+	}
+
+	T operator[](uint64_t index) const {
+		assert(index <= last_coordinate());
+		uint32_t node = 0;
+		for (unsigned level = bits; level > 0 && node != NONE; --level) {
+			node = nodes[node].child[(index >> (level - 1)) & 1];
+		}
+		return node == NONE ? Monoid::identity() : nodes[node].value;
+	}
+
+	uint64_t last_coordinate() const {
+		return low_mask(bits);
+	}
+
+	size_t node_count() const {
+		return nodes.size();
+	}
+
+	void reserve(size_t count) {
+		nodes.reserve(count);
+	}
+
+	void clear() {
+		nodes.clear();
+		allocate();
+	}
+
+	// Prints the elements that have been set, in order.
+	void print() const {
+		print(0, bits, 0);
+	}
+
+private:
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+	struct Node {
+		T value;
+		uint32_t child[2];
+	};
+
+	unsigned bits;
+	std::vector<Node> nodes;
+	Monoid combine;
+
+	// The last coordinate under a node covering 2^level elements is its
+	// first one ORed with this.
+	static uint64_t low_mask(unsigned level) {
+		return level == 64 ? ~uint64_t(0) : (uint64_t(1) << level) - 1;
+	}
+
+	uint32_t allocate() {
+		if (nodes.size() >= NONE) {
+			throw std::runtime_error("SparseSegmentTree pool is full");
+		}
+		nodes.push_back(Node{Monoid::identity(), {NONE, NONE}});
+		return nodes.size() - 1;
+	}
+
+	// Applies change to the element at index, creating its path if
+	// needed, then refolds the path bottom up.
+	template <typename Change>
+	void modify(uint64_t index, Change change) {
+		assert(index <= last_coordinate());
+		uint32_t path[65];
+		uint32_t node = 0;
+		path[0] = node;
+		for (unsigned level = bits; level > 0; --level) {
+			unsigned bit = (index >> (level - 1)) & 1;
+			if (nodes[node].child[bit] == NONE) {
+				uint32_t child = allocate();
+				nodes[node].child[bit] = child;
+			}
+			node = nodes[node].child[bit];
+			path[bits - level + 1] = node;
+		}
+
+		change(nodes[node].value);
+		for (unsigned depth = bits; depth-- > 0;) {
+			Node& parent = nodes[path[depth]];
+			if (parent.child[0] == NONE) {
+				parent.value = nodes[parent.child[1]].value;
+			} else if (parent.child[1] == NONE) {
+				parent.value = nodes[parent.child[0]].value;
+			} else {
+				parent.value = combine(nodes[parent.child[0]].value,
+					nodes[parent.child[1]].value);
+			}
+		}
+	}
+
+	// Fold of the elements in [left, right] under node, which covers the
+	// 2^level coordinates from start and overlaps the range.
+	T fold(uint32_t node, unsigned level, uint64_t start, uint64_t left,
+			uint64_t right) const {
+		if (node == NONE) {
+			return Monoid::identity();
+		}
+		if (left <= start && (start | low_mask(level)) <= right) {
+			return nodes[node].value;
+		}
+
+		uint64_t mid = start | (uint64_t(1) << (level - 1));
+		T result = Monoid::identity();
+		if (left < mid) {
+			result = fold(nodes[node].child[0], level - 1, start, left, right);
+		}
+		if (right >= mid) {
+			result = combine(std::move(result),
+				fold(nodes[node].child[1], level - 1, mid, left, right));
+		}
+		return result;
+	}
+
+	void print(uint32_t node, unsigned level, uint64_t start) const {
+		if (node == NONE) {
+			return;
+		}
+		if (level == 0) {
+			std::cout << start << ": " << nodes[node].value << '\n';
+			return;
+		}
+		print(nodes[node].child[0], level - 1, start);
+		print(nodes[node].child[1], level - 1,
+			start | (uint64_t(1) << (level - 1)));
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_SPARSE_SEGMENT_TREE_H */
@@ -0,0 +1,32 @@
+#include <cstdint>
+#include "sparse_segment_tree.h"
+using namespace std;
+
+int main() {
+	// Events counted per nanosecond timestamp, over a 2^63 domain.
+	const uint64_t second = 1000000000;
+	uint64_t base = uint64_t(1700000000) * second;
+	fontus::SparseSegmentTree<long> events(63);
+	for (uint64_t offset: {uint64_t(0), uint64_t(15), second - 1, second,
+			2*second + 7, 2*second + 7, 60*second}) {
+		events.add(base + offset, 1);
+	}
+	events.print();
+	cout << "events in second 0: "
+	     << events.query(base, base + second - 1) << '\n';
+	cout << "events in seconds 1-2: "
+	     << events.query(base + second, base + 3*second - 1) << '\n';
+	cout << "events overall: " << events.query(0, events.last_coordinate())
+	     << '\n';
+	cout << "nodes: " << events.node_count() << '\n';
+
+	// Largest latency seen per key of a 64-bit hash space.
+	fontus::SparseSegmentTree<int, fontus::Max<int>> latencies;
+	latencies.update(12, 0x9e3779b97f4a7c15ull);
+	latencies.update(40, 0xffffffffffffffffull);
+	latencies.update(7, 42);
+	cout << "max[0, 2^63) = " << latencies.query(0, (uint64_t(1) << 63) - 1)
+	     << '\n';
+	cout << "max over all = " << latencies.query(0, ~uint64_t(0)) << '\n';
+	cout << "latency of 42 = " << latencies[42] << '\n';
+}
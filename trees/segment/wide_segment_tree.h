@@ -0,0 +1,175 @@
+#ifndef FONTUS_WIDE_SEGMENT_TREE_H
+#define FONTUS_WIDE_SEGMENT_TREE_H
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace fontus {
+
+// Static B-ary segment tree for prefix sums over arithmetic types (an
+// S-tree in the sense of Algorithmica's "wide segment trees"). Each
+// node is B values filling one 64-byte cache line, and node ranges are
+// implicit in the layout, so nothing but sums is stored.
+//
+// Layer h splits the elements into blocks of B^h and holds one value
+// per block: the sum of the blocks before it within the same node.
+// The sum of the first k elements is thus one load per layer, at
+// index k >> (h * log2 B). Adding to an element adds to the trailing
+// values of one node per layer, B lanes at a time with AVX2.
+template <typename T, typename Iter, unsigned B = 64 / sizeof(T)>
+class WideSegmentTree {
+	static_assert(std::is_arithmetic<T>::value,
+		"WideSegmentTree needs + and - on T");
+	static_assert(B >= 2 && (B & (B - 1)) == 0,
+		"node width must be a power of two");
+
+public:
+	WideSegmentTree(Iter start, Iter end) : size(end - start) {
+		// Layer h needs an entry for every k >> (h * BITS), k <= size.
+		std::vector<size_t> layer_nodes;
+		for (size_t entries = size + 1;; entries = (entries + B - 1) / B) {
+			layer_nodes.push_back((entries + B - 1) / B);
+			if (entries <= B) {
+				break;
+			}
+		}
+		size_t total = 0;
+		for (size_t count: layer_nodes) {
+			offsets.push_back(total);
+			total += count;
+		}
+		nodes.resize(total);
+
+		// Block sums of the layer being built, starting with the
+		// elements themselves.
+		std::vector<T> sums(start, end);
+		for (size_t h = 0; h < layer_nodes.size(); ++h) {
+			std::vector<T> next((sums.size() + B - 1) / B);
+			for (size_t i = 0; i < next.size(); ++i) {
+				T* node = nodes[offsets[h] + i].values;
+				T running{};
+				for (unsigned j = 0; j < B; ++j) {
+					node[j] = running;
+					size_t index = i * B + j;
+					if (index < sums.size()) {
+						running += sums[index];
+					}
+				}
+				next[i] = running;
+			}
+			sums.swap(next);
+		}
+	}
+
+	// Sum of the first k elements.
+	T prefix(size_t k) const {
+		assert(k <= size);
+		T sum{};
+		for (size_t h = 0; h < offsets.size(); ++h) {
+			size_t i = k >> (h * BITS);
+			sum += nodes[offsets[h] + i / B].values[i % B];
+		}
+		return sum;
+	}
+
+	// Sum of the elements in [left, right].
+	T query(size_t left, size_t right) const {
+		assert(left <= right && right < size);
+		return prefix(right + 1) - prefix(left);
+	}
+
+	void add(size_t index, T delta) {
+		assert(index < size);
+		for (size_t h = 0; h < offsets.size(); ++h) {
+			size_t i = index >> (h * BITS);
+			add_after(nodes[offsets[h] + i / B].values, i % B, delta);
+		}
+	}
+
+	void update(const T& val, size_t index) {
+		add(index, val - query(index, index));
+	}
+
+	T operator[](size_t index) const {
+		return query(index, index);
+	}
+
+	size_t length() const {
+		return size;
+	}
+
+	void print() const {
+		for (size_t h = offsets.size(); h-- > 0;) {
+			size_t end = (h + 1 < offsets.size()) ? offsets[h + 1]
+				: nodes.size();
+			std::cout << "layer " << h << ':';
+			for (size_t i = offsets[h]; i < end; ++i) {
+				for (auto value: nodes[i].values) {
+					std::cout << ' ' << value;
+				}
+			}
+			std::cout << '\n';
+		}
+	}
+
+private:
+	static constexpr unsigned BITS = __builtin_ctz(B);
+
+	// A cache line, or an aligned fraction of one for narrow nodes.
+	struct alignas(B * sizeof(T) < 64 ? B * sizeof(T) : 64) Node {
+		T values[B];
+	};
+
+	size_t size;
+	std::vector<Node> nodes;
+	// First node of each layer, leaves first.
+	std::vector<size_t> offsets;
+
+	// Adds delta to the values after position digit of a node: the
+	// blocks that follow the updated one.
+	static void add_after(T* node, unsigned digit, T delta) {
+#ifdef __AVX2__
+		if constexpr (std::is_integral<T>::value && sizeof(T) == 4 &&
+				B % 8 == 0) {
+			const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			const __m256i after = _mm256_set1_epi32(digit);
+			const __m256i add = _mm256_set1_epi32(delta);
+			for (unsigned j = 0; j < B; j += 8) {
+				__m256i index = _mm256_add_epi32(lanes, _mm256_set1_epi32(j));
+				__m256i mask = _mm256_cmpgt_epi32(index, after);
+				__m256i* chunk = reinterpret_cast<__m256i*>(node + j);
+				_mm256_store_si256(chunk, _mm256_add_epi32(
+					_mm256_load_si256(chunk), _mm256_and_si256(mask, add)));
+			}
+			return;
+		}
+		if constexpr (std::is_integral<T>::value && sizeof(T) == 8 &&
+				B % 4 == 0) {
+			const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+			const __m256i after = _mm256_set1_epi64x(digit);
+			const __m256i add = _mm256_set1_epi64x(delta);
+			for (unsigned j = 0; j < B; j += 4) {
+				__m256i index = _mm256_add_epi64(lanes, _mm256_set1_epi64x(j));
+				__m256i mask = _mm256_cmpgt_epi64(index, after);
+				__m256i* chunk = reinterpret_cast<__m256i*>(node + j);
+				_mm256_store_si256(chunk, _mm256_add_epi64(
+					_mm256_load_si256(chunk), _mm256_and_si256(mask, add)));
+			}
+			return;
+		}
+#endif
+		for (unsigned j = 0; j < B; ++j) {
+			node[j] += (j > digit) ? delta : T{};
+		}
+	}
+};
+
+} // namespace fontus
+
+#endif /* FONTUS_WIDE_SEGMENT_TREE_H */
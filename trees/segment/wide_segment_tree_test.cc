@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "segment_tree.h"
+#include "wide_segment_tree.h"
+using namespace std;
+
+// Prefix sums on a wide tree, checked against SegmentTree. Pass a
+// larger element count to also compare their speed.
+// Usage: wide_segment_tree_test [elements]
+
+typedef chrono::steady_clock Clock;
+
+int main(int argc, char* argv[]) {
+	int arr[20] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+		11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+	fontus::WideSegmentTree<int, int*, 4> small(&arr[0], &arr[20]);
+	small.print();
+	small.add(3, 100);
+	small.update(0, 19);	// zero the last element
+	small.print();
+	cout << "sum[0, 19] = " << small.query(0, 19) << '\n';
+	cout << "sum[2, 5] = " << small.query(2, 5) << '\n';
+
+	size_t n = (argc > 1) ? strtoul(argv[1], nullptr, 10) : (1 << 16);
+	mt19937 rng(1);
+	vector<int> values(n);
+	for (auto& value: values) {
+		value = rng() % 100;
+	}
+	vector<size_t> lefts(max<size_t>(n / 4, 1 << 12)), rights(lefts.size());
+	for (size_t i = 0; i < lefts.size(); ++i) {
+		lefts[i] = rng() % n;
+		rights[i] = lefts[i] + rng() % (n - lefts[i]);
+	}
+
+	typedef vector<int>::iterator Iter;
+	fontus::SegmentTree<int, Iter> binary(values.begin(), values.end());
+	fontus::WideSegmentTree<int, Iter> wide(values.begin(), values.end());
+	for (size_t i = 0; i < lefts.size(); ++i) {
+		size_t index = rng() % n;
+		int delta = int(rng() % 100) - 50;
+		binary.update(binary[index] + delta, index);
+		wide.add(index, delta);
+	}
+
+	auto start = Clock::now();
+	vector<long> binary_sums(lefts.size());
+	for (size_t i = 0; i < lefts.size(); ++i) {
+		binary_sums[i] = binary.query(lefts[i], rights[i]);
+	}
+	auto middle = Clock::now();
+	vector<long> wide_sums(lefts.size());
+	for (size_t i = 0; i < lefts.size(); ++i) {
+		wide_sums[i] = wide.query(lefts[i], rights[i]);
+	}
+	auto end = Clock::now();
+
+	for (size_t i = 0; i < lefts.size(); ++i) {
+		if (binary_sums[i] != wide_sums[i]) {
+			cout << "sum[" << lefts[i] << ", " << rights[i] << "] is "
+			     << wide_sums[i] << ", expected " << binary_sums[i] << '\n';
+			return 1;
+		}
+	}
+	cout << lefts.size() << " range sums over " << n << " elements agree\n";
+	if (argc > 1) {
+		cout << "  SegmentTree     "
+		     << chrono::duration<double, milli>(middle - start).count()
+		     << " ms\n"
+		     << "  WideSegmentTree "
+		     << chrono::duration<double, milli>(end - middle).count()
+		     << " ms\n";
+	}
+}